@@ -0,0 +1,153 @@
+#pragma once
+
+/// Fixture files and edit patterns shared by the benchmarks
+
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "Helix.hpp"
+
+namespace HelixBench {
+    enum class FixtureContent {
+        /// Random bytes throughout, which has to be written out in full
+        Random,
+        /// Mostly a hole, with a block of random bytes every MiB. Quick to create even at tens of GB, on filesystems
+        /// that support sparse files.
+        Sparse,
+    };
+
+    /// How the actions applied for a benchmark are placed in the file
+    enum class EditPattern {
+        /// Spread out evenly over the whole file
+        Sparse,
+        /// At random positions within a small window in the middle of the file
+        Dense,
+    };
+
+    inline const char* getName (FixtureContent content) {
+        return content == FixtureContent::Random ? "random" : "sparse";
+    }
+
+    inline const char* getName (EditPattern pattern) {
+        return pattern == EditPattern::Sparse ? "sparse" : "dense";
+    }
+
+    /// Parses a size such as 10K, 64M or 20G (powers of 1024)
+    inline size_t parseSize (const std::string& text) {
+        size_t suffix_start = 0;
+        const unsigned long long value = std::stoull(text, &suffix_start);
+        const std::string suffix = text.substr(suffix_start);
+        if (suffix.empty() || suffix == "B") {
+            return value;
+        } else if (suffix == "K" || suffix == "KB" || suffix == "KiB") {
+            return value * 1024;
+        } else if (suffix == "M" || suffix == "MB" || suffix == "MiB") {
+            return value * 1024 * 1024;
+        } else if (suffix == "G" || suffix == "GB" || suffix == "GiB") {
+            return value * 1024 * 1024 * 1024;
+        }
+        throw std::runtime_error("Unknown size suffix: " + text);
+    }
+
+    /// Comma separated list of values, each parsed with `parse`
+    template<typename Parse>
+    auto parseList (const std::string& text, Parse&& parse) {
+        std::vector<decltype(parse(text))> result;
+        size_t start = 0;
+        while (start <= text.size()) {
+            const size_t end = std::min(text.find(',', start), text.size());
+            if (end > start) {
+                result.push_back(parse(text.substr(start, end - start)));
+            }
+            start = end + 1;
+        }
+        return result;
+    }
+
+    inline void writeFixture (const std::filesystem::path& path, size_t size, FixtureContent content=FixtureContent::Random) {
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+        std::mt19937 engine(0);
+        const size_t chunk_size = 1024 * 1024;
+        std::vector<char> chunk(content == FixtureContent::Random ? chunk_size : 4096);
+        for (size_t written = 0; written < size; written += chunk_size) {
+            for (char& value : chunk) {
+                value = static_cast<char>(engine());
+            }
+            if (content == FixtureContent::Sparse) {
+                output.seekp(static_cast<std::streamoff>(written));
+            }
+            output.write(chunk.data(), static_cast<std::streamsize>(std::min(chunk.size(), size - written)));
+        }
+        output.close();
+        // Extends the last hole of a sparse fixture out to the full size
+        std::filesystem::resize_file(path, size);
+    }
+
+    /// Places actions on a file of `file_size` following `pattern`, keeping track of the size as insertions and
+    /// deletions change it so every action stays within the file
+    class EditGenerator {
+        public:
+        static constexpr size_t dense_window = 64 * 1024;
+
+        explicit EditGenerator (EditPattern t_pattern, size_t file_size, size_t t_count) :
+            pattern(t_pattern), size(file_size), count(t_count), engine(1) {}
+
+        size_t getSize () const {
+            return size;
+        }
+
+        /// Position for the `index`th action, which changes `amount` bytes
+        AlphaFile::Natural nextPosition (size_t index, size_t amount) {
+            const size_t limit = size > amount ? size - amount : 0;
+            if (limit == 0) {
+                return 0;
+            }
+            if (pattern == EditPattern::Sparse) {
+                return std::min<size_t>((size / (count + 1)) * (index + 1), limit);
+            }
+            const size_t window = std::min(dense_window, limit);
+            const size_t start = (limit - window) / 2;
+            return start + (engine() % window);
+        }
+
+        std::byte nextValue () {
+            return std::byte(static_cast<uint8_t>(engine()));
+        }
+
+        /// Applies `count` actions: half edits, a quarter insertions and a quarter deletions, of 1 to 16 bytes.
+        /// `edits_only` applies only edits, such as for sessions saved in place.
+        void apply (Helix::Helix& helix, bool edits_only=false) {
+            for (size_t index = 0; index < count; index++) {
+                const size_t amount = 1 + (engine() % 16);
+                const AlphaFile::Natural position = nextPosition(index, amount);
+                const size_t kind = edits_only ? 0 : index % 4;
+                if (kind < 2 || size <= amount) {
+                    std::vector<std::byte> values(std::min(amount, size - position));
+                    for (std::byte& value : values) {
+                        value = nextValue();
+                    }
+                    helix.edit(position, std::move(values));
+                } else if (kind == 2) {
+                    helix.insert(position, amount, nextValue());
+                    size += amount;
+                } else {
+                    helix.deletion(position, amount);
+                    size -= amount;
+                }
+            }
+        }
+
+        protected:
+        EditPattern pattern;
+        size_t size;
+        size_t count;
+        std::mt19937_64 engine;
+    };
+} // namespace HelixBench
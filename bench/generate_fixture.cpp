@@ -0,0 +1,25 @@
+/// Writes a fixture file for the benchmarks, or for trying things out by hand.
+/// Usage: helix_generate_fixture <size, such as 10K, 64M or 20G> <output> [random|sparse]
+/// Sparse fixtures are mostly holes, so even tens of GB are quick to create.
+
+#include <iostream>
+#include <string>
+
+#include "fixture.hpp"
+
+int main (int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <size> <output> [random|sparse]\n";
+        return 1;
+    }
+
+    const size_t size = HelixBench::parseSize(argv[1]);
+    const std::string content = argc > 3 ? argv[3] : "random";
+    if (content != "random" && content != "sparse") {
+        std::cerr << "Unknown fixture content: " << content << "\n";
+        return 1;
+    }
+
+    HelixBench::writeFixture(argv[2], size, content == "sparse" ? HelixBench::FixtureContent::Sparse : HelixBench::FixtureContent::Random);
+    return 0;
+}
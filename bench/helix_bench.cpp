@@ -0,0 +1,279 @@
+/// Measures the read, edit and save paths of Helix over a range of file sizes, action counts and edit patterns.
+/// Usage: bench_helix [--sizes 10K,1M,64M] [--actions 0,100,10000] [--directory dir] [--output results.jsonl]
+/// Prints one JSON object per line for each measurement, so results can be collected and compared across versions:
+/// {"version", "benchmark", "backend", "file_size", "fixture", "pattern", "actions", "operations", "seconds",
+///  "ns_per_op", "mib_per_second"}
+
+#include <iostream>
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include "fixture.hpp"
+#include "EditBatch.hpp"
+#include "FileCopy.hpp"
+
+#ifndef HELIX_BENCH_VERSION
+#define HELIX_BENCH_VERSION "unknown"
+#endif
+
+namespace {
+    using HelixBench::EditPattern;
+    using HelixBench::FixtureContent;
+
+    /// Fixtures larger than this are made sparse, as writing tens of GB of random bytes would take longer than the
+    /// benchmarks themselves
+    constexpr size_t max_random_fixture = 256 * 1024 * 1024;
+    /// Fixtures larger than this skip the save benchmarks, which write out the whole (no longer sparse) file several
+    /// times per case
+    constexpr size_t max_save_fixture = 1024 * 1024 * 1024;
+    /// Chunk size for copying the fixture before each save
+    constexpr size_t copy_chunk_size = 16 * 1024 * 1024;
+
+    constexpr size_t byte_reads = 100000;
+    constexpr size_t range_reads = 10000;
+    constexpr size_t range_size = 4096;
+    constexpr size_t typed_reads = 50000;
+
+    /// Keeps the reads from being optimized out
+    volatile uint64_t sink = 0;
+
+    struct Config {
+        std::vector<size_t> sizes = {10 * 1024, 1024 * 1024, 64 * 1024 * 1024};
+        std::vector<size_t> action_counts = {0, 100, 10000};
+        std::filesystem::path directory = std::filesystem::temp_directory_path();
+        std::optional<std::filesystem::path> output;
+    };
+
+    struct Case {
+        std::string backend;
+        size_t file_size;
+        FixtureContent fixture;
+        EditPattern pattern;
+        size_t action_count;
+    };
+
+    class Reporter {
+        public:
+        explicit Reporter (std::ostream& t_output) : output(t_output) {}
+
+        void report (const std::string& benchmark, const Case& bench_case, size_t operations, double seconds, std::optional<size_t> bytes=std::nullopt) {
+            std::ostringstream line;
+            line << "{\"version\":\"" << HELIX_BENCH_VERSION << "\""
+                << ",\"benchmark\":\"" << benchmark << "\""
+                << ",\"backend\":\"" << bench_case.backend << "\""
+                << ",\"file_size\":" << bench_case.file_size
+                << ",\"fixture\":\"" << HelixBench::getName(bench_case.fixture) << "\""
+                << ",\"pattern\":\"" << HelixBench::getName(bench_case.pattern) << "\""
+                << ",\"actions\":" << bench_case.action_count
+                << ",\"operations\":" << operations
+                << ",\"seconds\":" << seconds
+                << ",\"ns_per_op\":" << (operations == 0 ? 0.0 : seconds * 1e9 / static_cast<double>(operations));
+            if (bytes.has_value()) {
+                line << ",\"mib_per_second\":" << (static_cast<double>(bytes.value()) / (1024.0 * 1024.0) / seconds);
+            }
+            line << "}\n";
+            output << line.str() << std::flush;
+        }
+
+        protected:
+        std::ostream& output;
+    };
+
+    double measure (const std::function<void()>& func) {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        const auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - start).count();
+    }
+
+    Helix::Flags makeFlags (const std::string& backend) {
+        Helix::Flags flags(Helix::WholeFileMode{});
+        flags.read_backend = backend == "mapped" ? Helix::ReadBackend::MemoryMapped : Helix::ReadBackend::BlockCache;
+        return flags;
+    }
+
+    /// Single byte, range and typed reads at random positions, after applying the case's actions
+    void benchReads (Reporter& reporter, const std::filesystem::path& fixture, const Case& bench_case) {
+        MlActions::ActionList action_list;
+        Helix::Helix helix(action_list, fixture, makeFlags(bench_case.backend));
+        HelixBench::EditGenerator generator(bench_case.pattern, bench_case.file_size, bench_case.action_count);
+        generator.apply(helix);
+
+        const size_t size = generator.getSize();
+        if (size == 0) {
+            return;
+        }
+
+        std::mt19937_64 engine(2);
+        double seconds = measure([&] () {
+            for (size_t index = 0; index < byte_reads; index++) {
+                sink = sink + static_cast<uint64_t>(helix.read(engine() % size).value_or(std::byte(0)));
+            }
+        });
+        reporter.report("read_byte", bench_case, byte_reads, seconds);
+
+        std::vector<std::byte> buffer(range_size);
+        seconds = measure([&] () {
+            for (size_t index = 0; index < range_reads; index++) {
+                sink = sink + helix.read(engine() % size, buffer.data(), buffer.size());
+            }
+        });
+        reporter.report("read_range_4k", bench_case, range_reads, seconds, range_reads * range_size);
+
+        if (size < sizeof(uint64_t)) {
+            return;
+        }
+        seconds = measure([&] () {
+            for (size_t index = 0; index < typed_reads; index++) {
+                const AlphaFile::Natural position = engine() % (size - sizeof(uint64_t));
+                sink = sink + helix.readU32LE(position).value_or(0);
+                sink = sink + static_cast<uint64_t>(helix.readF64BE(position).value_or(0.0));
+            }
+        });
+        reporter.report("read_typed", bench_case, typed_reads * 2, seconds);
+    }
+
+    /// How quickly actions of each kind are added
+    void benchActions (Reporter& reporter, const std::filesystem::path& fixture, const Case& bench_case) {
+        const size_t count = bench_case.action_count;
+        if (count == 0) {
+            return;
+        }
+        const std::vector<std::pair<std::string, std::function<void(Helix::Helix&, HelixBench::EditGenerator&, size_t)>>> kinds = {
+            {"edit", [] (Helix::Helix& helix, HelixBench::EditGenerator& generator, size_t index) {
+                helix.edit(generator.nextPosition(index, 1), generator.nextValue());
+            }},
+            {"insert", [] (Helix::Helix& helix, HelixBench::EditGenerator& generator, size_t index) {
+                helix.insert(generator.nextPosition(index, 0), 16, generator.nextValue());
+            }},
+            {"delete", [] (Helix::Helix& helix, HelixBench::EditGenerator& generator, size_t index) {
+                helix.deletion(generator.nextPosition(index, 1), 1);
+            }},
+        };
+
+        for (const auto& [name, apply] : kinds) {
+            MlActions::ActionList action_list;
+            Helix::Helix helix(action_list, fixture, makeFlags(bench_case.backend));
+            // Only positions are taken from the generator, so the size it tracks staying put doesn't matter
+            HelixBench::EditGenerator generator(bench_case.pattern, bench_case.file_size, count);
+            const double seconds = measure([&] () {
+                for (size_t index = 0; index < count; index++) {
+                    apply(helix, generator, index);
+                }
+            });
+            reporter.report(name, bench_case, count, seconds);
+        }
+
+        // The same edits made as one batch
+        MlActions::ActionList action_list;
+        Helix::Helix helix(action_list, fixture, makeFlags(bench_case.backend));
+        HelixBench::EditGenerator generator(bench_case.pattern, bench_case.file_size, count);
+        const double seconds = measure([&] () {
+            Helix::EditBatch batch;
+            for (size_t index = 0; index < count; index++) {
+                batch.edit(generator.nextPosition(index, 1), generator.nextValue());
+            }
+            helix.commitBatch(std::move(batch));
+        });
+        reporter.report("batch_edit", bench_case, count, seconds);
+    }
+
+    /// Saving over a copy of the fixture, saving an edit-only session in place, and saving as a new file
+    void benchSaves (Reporter& reporter, const std::filesystem::path& fixture, const Case& bench_case, const std::filesystem::path& directory) {
+        const std::filesystem::path working = directory / "helix_bench_working.bin";
+        const std::filesystem::path destination = directory / "helix_bench_destination.bin";
+
+        const auto run = [&] (const std::string& name, bool edits_only, std::optional<Helix::InPlaceSave> in_place, bool save_as) {
+            // Reflinked (or copied in the kernel) where possible, rather than read and written through a buffer
+            Helix::copyFile(fixture, working, copy_chunk_size, [] (size_t) {
+                return true;
+            });
+            std::filesystem::remove(destination);
+
+            MlActions::ActionList action_list;
+            Helix::Flags flags = makeFlags(bench_case.backend);
+            if (in_place.has_value()) {
+                flags.in_place_save = in_place.value();
+            }
+            Helix::Helix helix(action_list, working, flags);
+            HelixBench::EditGenerator generator(bench_case.pattern, bench_case.file_size, bench_case.action_count);
+            generator.apply(helix, edits_only);
+
+            Helix::SaveStatus status = Helix::SaveStatus::Success;
+            const double seconds = measure([&] () {
+                status = save_as ? helix.saveAs(destination) : helix.save();
+            });
+            if (status != Helix::SaveStatus::Success) {
+                std::cerr << name << " failed with status " << status << "\n";
+                return;
+            }
+            reporter.report(name, bench_case, 1, seconds, generator.getSize());
+        };
+
+        run("save", false, std::nullopt, false);
+        run("save_in_place", true, Helix::InPlaceSave::Direct, false);
+        run("save_as", false, std::nullopt, true);
+
+        std::filesystem::remove(working);
+        std::filesystem::remove(destination);
+    }
+
+    Config parseArguments (int argc, char** argv) {
+        Config config;
+        for (int index = 1; index + 1 < argc; index += 2) {
+            const std::string name = argv[index];
+            const std::string value = argv[index + 1];
+            if (name == "--sizes") {
+                config.sizes = HelixBench::parseList(value, HelixBench::parseSize);
+            } else if (name == "--actions") {
+                config.action_counts = HelixBench::parseList(value, [] (const std::string& text) -> size_t {
+                    return std::stoull(text);
+                });
+            } else if (name == "--directory") {
+                config.directory = value;
+            } else if (name == "--output") {
+                config.output = value;
+            } else {
+                throw std::runtime_error("Unknown argument: " + name);
+            }
+        }
+        return config;
+    }
+}
+
+int main (int argc, char** argv) {
+    const Config config = parseArguments(argc, argv);
+
+    std::ofstream output_file;
+    if (config.output.has_value()) {
+        output_file.open(config.output.value(), std::ios::trunc);
+    }
+    Reporter reporter(config.output.has_value() ? static_cast<std::ostream&>(output_file) : std::cout);
+
+    for (size_t size : config.sizes) {
+        const FixtureContent content = size > max_random_fixture ? FixtureContent::Sparse : FixtureContent::Random;
+        const std::filesystem::path fixture = config.directory / ("helix_bench_" + std::to_string(size) + "_" + HelixBench::getName(content) + ".bin");
+        HelixBench::writeFixture(fixture, size, content);
+
+        for (size_t action_count : config.action_counts) {
+            for (EditPattern pattern : {EditPattern::Sparse, EditPattern::Dense}) {
+                for (const std::string backend : {"block_cache", "mapped"}) {
+                    const Case bench_case{backend, size, content, pattern, action_count};
+                    benchReads(reporter, fixture, bench_case);
+                }
+
+                const Case bench_case{"block_cache", size, content, pattern, action_count};
+                benchActions(reporter, fixture, bench_case);
+                if (size <= max_save_fixture) {
+                    benchSaves(reporter, fixture, bench_case, config.directory);
+                }
+            }
+        }
+
+        std::filesystem::remove(fixture);
+    }
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+/// Measures how the chunk size used to shift the file affects the speed of a replayed save.
+/// Usage: bench_save_chunk_size [file size in bytes] [actions]
+/// Prints one CSV line per chunk size: chunk_size,seconds,mib_per_second
+
+#include <iostream>
+#include <chrono>
+#include <string>
+
+#include "fixture.hpp"
+
+namespace {
+    double runSave (const std::filesystem::path& source, const std::filesystem::path& destination, std::optional<size_t> chunk_size, size_t file_size, size_t action_count) {
+        MlActions::ActionList action_list;
+        Helix::Flags flags(Helix::WholeFileMode{});
+        flags.save_strategy = Helix::SaveStrategy::Replay;
+        flags.save_chunk_size = chunk_size;
+        Helix::Helix helix(action_list, source, flags);
+
+        // Alternate insertions and deletions spread over the file, each of which shifts everything after it
+        for (size_t i = 0; i < action_count; i++) {
+            const AlphaFile::Natural position = (file_size / (action_count + 1)) * (i + 1);
+            if (i % 2 == 0) {
+                helix.insert(position, 16);
+            } else {
+                helix.deletion(position, 16);
+            }
+        }
+
+        std::filesystem::remove(destination);
+        const auto start = std::chrono::steady_clock::now();
+        helix.saveAs(destination);
+        const auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - start).count();
+    }
+}
+
+int main (int argc, char** argv) {
+    const size_t file_size = argc > 1 ? std::stoull(argv[1]) : 64 * 1024 * 1024;
+    const size_t action_count = argc > 2 ? std::stoull(argv[2]) : 8;
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::filesystem::path source = directory / "helix_bench_chunk_source.bin";
+    const std::filesystem::path destination = directory / "helix_bench_chunk_destination.bin";
+    HelixBench::writeFixture(source, file_size);
+
+    const std::vector<std::optional<size_t>> chunk_sizes = {
+        120, 4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024,
+        // Adaptive
+        std::nullopt,
+    };
+
+    std::cout << "chunk_size,seconds,mib_per_second\n";
+    for (const std::optional<size_t>& chunk_size : chunk_sizes) {
+        const double seconds = runSave(source, destination, chunk_size, file_size, action_count);
+        // Every insertion/deletion moves (roughly) the whole file once
+        const double mebibytes = static_cast<double>(file_size) * static_cast<double>(action_count) / (1024.0 * 1024.0);
+        std::cout << (chunk_size.has_value() ? std::to_string(chunk_size.value()) : "adaptive") << ","
+            << seconds << "," << (mebibytes / seconds) << "\n";
+    }
+
+    std::filesystem::remove(source);
+    std::filesystem::remove(destination);
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "ActionArena.hpp"
+
+namespace Helix {
+	// ==== ActionArena:CountingResource ====
+	void* ActionArena::CountingResource::do_allocate (size_t bytes, size_t alignment) {
+		void* pointer = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		held += bytes;
+		return pointer;
+	}
+
+	void ActionArena::CountingResource::do_deallocate (void* pointer, size_t bytes, size_t alignment) {
+		std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+		held -= bytes;
+	}
+
+	bool ActionArena::CountingResource::do_is_equal (const std::pmr::memory_resource& other) const noexcept {
+		return this == &other;
+	}
+
+	// ==== ActionArena ====
+	ActionArena::ActionArena () : resource(initial_block_size, &upstream) {}
+
+	void ActionArena::release () {
+		resource.release();
+		used = 0;
+	}
+
+	size_t ActionArena::getBytesHeld () const {
+		return upstream.held;
+	}
+
+	size_t ActionArena::getBytesUsed () const {
+		return used;
+	}
+
+	void* ActionArena::do_allocate (size_t bytes, size_t alignment) {
+		used += bytes;
+		return resource.allocate(bytes, alignment);
+	}
+
+	void ActionArena::do_deallocate (void* pointer, size_t bytes, size_t alignment) {
+		// Only given back on release
+	}
+
+	bool ActionArena::do_is_equal (const std::pmr::memory_resource& other) const noexcept {
+		return this == &other;
+	}
+} // namespace Helix
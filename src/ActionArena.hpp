@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace Helix {
+    /// Append-only memory for action payloads.
+    /// Allocations are bumped out of large blocks and deallocating does nothing; everything is given back at once by
+    /// release. This keeps long editing sessions from spreading millions of tiny allocations over the heap.
+    /// The flip side is that payloads which are dropped (undone actions, or ones replaced by merging) keep their memory
+    /// until the next release, so getBytesUsed only ever grows until then.
+    class ActionArena : public std::pmr::memory_resource {
+        public:
+        static constexpr size_t initial_block_size = 64 * 1024;
+
+        explicit ActionArena ();
+
+        ActionArena (const ActionArena&) = delete;
+        ActionArena& operator= (const ActionArena&) = delete;
+
+        /// Frees everything that was allocated from the arena, none of which may still be in use.
+        void release ();
+
+        /// Bytes currently held from the system for the arena's blocks
+        size_t getBytesHeld () const;
+        /// Bytes handed out since the last release, including those that have been deallocated since
+        size_t getBytesUsed () const;
+
+        protected:
+        /// Counts what the arena holds, on top of the usual new/delete
+        struct CountingResource : public std::pmr::memory_resource {
+            size_t held = 0;
+
+            void* do_allocate (size_t bytes, size_t alignment) override;
+            void do_deallocate (void* pointer, size_t bytes, size_t alignment) override;
+            bool do_is_equal (const std::pmr::memory_resource& other) const noexcept override;
+        };
+
+        CountingResource upstream;
+        std::pmr::monotonic_buffer_resource resource;
+        size_t used = 0;
+
+        void* do_allocate (size_t bytes, size_t alignment) override;
+        void do_deallocate (void* pointer, size_t bytes, size_t alignment) override;
+        bool do_is_equal (const std::pmr::memory_resource& other) const noexcept override;
+    };
+} // namespace Helix
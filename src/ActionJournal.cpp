@@ -0,0 +1,294 @@
+#include "ActionJournal.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+
+namespace Helix {
+	namespace {
+		constexpr std::array<char, 4> journal_magic = {'H', 'L', 'X', 'A'};
+		constexpr size_t header_size = journal_magic.size() + sizeof(uint32_t) + sizeof(uint64_t);
+	}
+
+	// ==== ActionJournal:Constructors ====
+	std::filesystem::path ActionJournal::getJournalPath (const std::filesystem::path& filename) {
+		std::filesystem::path result = filename;
+		result += ".helix-actions";
+		return result;
+	}
+
+	ActionJournal::ActionJournal (std::filesystem::path t_path, std::chrono::milliseconds t_sync_interval, IOQueue& t_queue) :
+		path(std::move(t_path)), sync_interval(t_sync_interval), queue(t_queue), last_flush(std::chrono::steady_clock::now()) {}
+
+	ActionJournal::~ActionJournal () {
+		if (started) {
+			flush();
+		}
+	}
+
+	// ==== ActionJournal ====
+	void ActionJournal::sync (ActionListLink& actions, size_t base_size) {
+		if (!started) {
+			restart(base_size);
+		}
+
+		std::lock_guard<std::mutex> lock(pending_mutex);
+		// Undoing only ever changes the end of the list, so once a journaled action is still in place everything before
+		// it is as well. Walking back from the end keeps this proportional to what changed, not to the whole list.
+		const size_t count = actions.getActionCount();
+		size_t keep = std::min(serials.size(), count);
+		while (keep > 0 && serials[keep - 1] != actions.getActionSerial(keep - 1)) {
+			keep--;
+		}
+		// Merging into the last action changes it without changing its serial.
+		// A single merge is journaled as just what it added, otherwise the whole action is journaled again.
+		const uint64_t current_revision = actions.getRevision();
+		if (current_revision != revision && keep == serials.size() && keep != 0) {
+			const std::optional<ActionRecord>& merge = actions.getLastMerge();
+			if (current_revision == revision + 1 && keep == count && merge.has_value()) {
+				appendAmend(merge.value());
+			} else {
+				keep--;
+			}
+		}
+		revision = current_revision;
+
+		if (keep < serials.size()) {
+			appendTruncate(keep);
+			serials.resize(keep);
+		}
+		for (size_t index = keep; index < count; index++) {
+			const auto [begin, end] = actions.getActionRecords(index);
+			appendAction(begin, end);
+			serials.push_back(actions.getActionSerial(index));
+		}
+
+		if (!pending.empty() && !flush_scheduled) {
+			flush_scheduled = true;
+			queue.schedule(last_flush + sync_interval, [this] () {
+				flush();
+			});
+		}
+	}
+
+	void ActionJournal::flush () {
+		// Taken first, so that entries taken out of `pending` by different threads are written in order
+		std::lock_guard<std::mutex> file_lock(file_mutex);
+		std::vector<std::byte> entries;
+		{
+			std::lock_guard<std::mutex> lock(pending_mutex);
+			last_flush = std::chrono::steady_clock::now();
+			flush_scheduled = false;
+			entries.swap(pending);
+		}
+		if (entries.empty() || !file.is_open()) {
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size()));
+		file.flush();
+		util::syncFile(path);
+	}
+
+	void ActionJournal::restart (size_t base_size) {
+		std::lock_guard<std::mutex> file_lock(file_mutex);
+		std::lock_guard<std::mutex> lock(pending_mutex);
+		file.close();
+		file.open(path, std::ios::binary | std::ios::trunc);
+		started = true;
+		serials.clear();
+		pending.clear();
+
+		std::array<char, header_size> header;
+		const uint32_t journal_version = version;
+		const uint64_t size = base_size;
+		std::memcpy(header.data(), journal_magic.data(), journal_magic.size());
+		std::memcpy(header.data() + journal_magic.size(), &journal_version, sizeof(journal_version));
+		std::memcpy(header.data() + journal_magic.size() + sizeof(journal_version), &size, sizeof(size));
+		file.write(header.data(), header.size());
+		file.flush();
+		util::syncFile(path);
+		last_flush = std::chrono::steady_clock::now();
+	}
+
+	void ActionJournal::discard () {
+		std::lock_guard<std::mutex> file_lock(file_mutex);
+		std::lock_guard<std::mutex> lock(pending_mutex);
+		file.close();
+		started = false;
+		serials.clear();
+		pending.clear();
+		std::filesystem::remove(path);
+	}
+
+	std::optional<std::vector<std::unique_ptr<BaseAction>>> ActionJournal::read (const std::filesystem::path& path, size_t base_size, std::pmr::memory_resource* resource) {
+		std::ifstream input(path, std::ios::binary);
+		if (!input.is_open()) {
+			return std::nullopt;
+		}
+		const std::vector<char> contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+		if (contents.size() < header_size || !std::equal(journal_magic.begin(), journal_magic.end(), contents.begin())) {
+			return std::nullopt;
+		}
+
+		uint32_t journal_version = 0;
+		uint64_t size = 0;
+		std::memcpy(&journal_version, contents.data() + journal_magic.size(), sizeof(journal_version));
+		std::memcpy(&size, contents.data() + journal_magic.size() + sizeof(journal_version), sizeof(size));
+		if (journal_version == 0 || journal_version > version || size != base_size) {
+			return std::nullopt;
+		}
+
+		// The records of each action, or nullopt for ones that couldn't be journaled
+		std::vector<std::optional<std::vector<std::unique_ptr<BaseAction>>>> journaled;
+		const std::byte* position = reinterpret_cast<const std::byte*>(contents.data()) + header_size;
+		const std::byte* const end = reinterpret_cast<const std::byte*>(contents.data()) + contents.size();
+		while (position != end) {
+			// Anything that doesn't parse is where the journal was cut off
+			const std::optional<uint64_t> length = util::readVarint(position, end);
+			if (!length.has_value() || static_cast<uint64_t>(end - position) < length.value() + sizeof(uint32_t)) {
+				break;
+			}
+			const std::byte* payload = position;
+			const std::byte* const payload_end = payload + length.value();
+			uint32_t stored_checksum = 0;
+			std::memcpy(&stored_checksum, payload_end, sizeof(stored_checksum));
+			if (length.value() == 0 || stored_checksum != util::checksum(payload, static_cast<size_t>(length.value()))) {
+				break;
+			}
+			position = payload_end + sizeof(uint32_t);
+
+			const EntryKind kind = static_cast<EntryKind>(*payload);
+			payload++;
+			if (kind == EntryKind::Truncate) {
+				const std::optional<uint64_t> keep = util::readVarint(payload, payload_end);
+				if (!keep.has_value()) {
+					break;
+				}
+				if (keep.value() < journaled.size()) {
+					journaled.resize(static_cast<size_t>(keep.value()));
+				}
+			} else if (kind == EntryKind::Action || kind == EntryKind::Amend) {
+				std::optional<std::vector<std::unique_ptr<BaseAction>>> parts = readRecords(payload, payload_end, resource);
+				if (!parts.has_value()) {
+					break;
+				}
+
+				if (kind == EntryKind::Action) {
+					journaled.push_back(std::move(parts));
+				} else if (journaled.empty()) {
+					break;
+				} else if (journaled.back().has_value()) {
+					// Made after the action as it was, which has the same result as merging it in
+					std::vector<std::unique_ptr<BaseAction>>& action_parts = journaled.back().value();
+					std::move(parts.value().begin(), parts.value().end(), std::back_inserter(action_parts));
+				}
+			} else if (kind == EntryKind::Unrecoverable) {
+				// Kept as a gap, as it may still be undone later on in the journal
+				journaled.push_back(std::nullopt);
+			} else {
+				break;
+			}
+		}
+
+		// Nothing after an action that couldn't be journaled can be recovered, as it may depend on it
+		std::vector<std::unique_ptr<BaseAction>> result;
+		for (std::optional<std::vector<std::unique_ptr<BaseAction>>>& parts : journaled) {
+			if (!parts.has_value()) {
+				break;
+			}
+			if (parts.value().size() == 1) {
+				result.push_back(std::move(parts.value().front()));
+			} else {
+				result.push_back(std::make_unique<BundledAction>(std::move(parts.value())));
+			}
+		}
+		return result;
+	}
+
+	std::optional<std::vector<std::unique_ptr<BaseAction>>> ActionJournal::readRecords (const std::byte*& payload, const std::byte* payload_end, std::pmr::memory_resource* resource) {
+		const std::optional<uint64_t> record_count = util::readVarint(payload, payload_end);
+		if (!record_count.has_value()) {
+			return std::nullopt;
+		}
+
+		std::vector<std::unique_ptr<BaseAction>> parts;
+		for (uint64_t index = 0; index < record_count.value() && payload != payload_end; index++) {
+			const ActionRecord::Kind record_kind = static_cast<ActionRecord::Kind>(*payload);
+			payload++;
+			const std::optional<uint64_t> record_position = util::readVarint(payload, payload_end);
+			const std::optional<uint64_t> amount = util::readVarint(payload, payload_end);
+			if (!record_position.has_value() || !amount.has_value()) {
+				break;
+			}
+
+			if (record_kind == ActionRecord::Kind::Edit) {
+				if (static_cast<uint64_t>(payload_end - payload) < amount.value()) {
+					break;
+				}
+				std::vector<std::byte> data(payload, payload + amount.value());
+				payload += amount.value();
+				parts.push_back(std::make_unique<EditAction>(record_position.value(), std::move(data), resource));
+			} else if (record_kind == ActionRecord::Kind::Insertion) {
+				parts.push_back(std::make_unique<InsertionAction>(record_position.value(), static_cast<size_t>(amount.value())));
+			} else if (record_kind == ActionRecord::Kind::Deletion) {
+				parts.push_back(std::make_unique<DeletionAction>(record_position.value(), static_cast<size_t>(amount.value())));
+			}
+		}
+		if (parts.size() != record_count.value()) {
+			return std::nullopt;
+		}
+		return parts;
+	}
+
+	void ActionJournal::appendEntry (const std::vector<std::byte>& payload) {
+		util::writeVarint(pending, payload.size());
+		pending.insert(pending.end(), payload.begin(), payload.end());
+		const uint32_t payload_checksum = util::checksum(payload.data(), payload.size());
+		const std::byte* checksum_bytes = reinterpret_cast<const std::byte*>(&payload_checksum);
+		pending.insert(pending.end(), checksum_bytes, checksum_bytes + sizeof(payload_checksum));
+	}
+
+	void ActionJournal::appendTruncate (size_t keep) {
+		std::vector<std::byte> payload;
+		payload.push_back(std::byte(EntryKind::Truncate));
+		util::writeVarint(payload, keep);
+		appendEntry(payload);
+	}
+
+	void ActionJournal::appendAction (const ActionRecord* begin, const ActionRecord* end) {
+		std::vector<std::byte> payload;
+		const bool recoverable = std::none_of(begin, end, [] (const ActionRecord& record) {
+			return record.kind == ActionRecord::Kind::Opaque;
+		});
+		if (!recoverable) {
+			payload.push_back(std::byte(EntryKind::Unrecoverable));
+			appendEntry(payload);
+			return;
+		}
+
+		payload.push_back(std::byte(EntryKind::Action));
+		appendRecords(payload, begin, end);
+		appendEntry(payload);
+	}
+
+	void ActionJournal::appendAmend (const ActionRecord& record) {
+		std::vector<std::byte> payload;
+		payload.push_back(std::byte(EntryKind::Amend));
+		appendRecords(payload, &record, &record + 1);
+		appendEntry(payload);
+	}
+
+	void ActionJournal::appendRecords (std::vector<std::byte>& payload, const ActionRecord* begin, const ActionRecord* end) {
+		util::writeVarint(payload, static_cast<uint64_t>(end - begin));
+		for (const ActionRecord* record = begin; record != end; record++) {
+			payload.push_back(std::byte(record->kind));
+			util::writeVarint(payload, record->position);
+			util::writeVarint(payload, record->amount);
+			if (record->kind == ActionRecord::Kind::Edit) {
+				payload.insert(payload.end(), record->data, record->data + record->amount);
+			}
+		}
+	}
+} // namespace Helix
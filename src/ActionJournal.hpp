@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <filesystem>
+
+#include "Helix.hpp"
+
+namespace Helix {
+    /// Append-only log of the actions that haven't been saved yet, so that they can be recovered after a crash.
+    /// Entries are encoded into memory as actions are made, so journaling an action costs about as much as copying it.
+    /// They're written out (and synced to the disk) by a job scheduled on an IOQueue, at most one sync interval after
+    /// they were made, even if nothing else happens in the meantime. The queue has to be destroyed before the journal,
+    /// as it runs the scheduled job when it is.
+    ///
+    /// The journal records actions by their ActionRecords, so user-defined (Opaque) actions can't be recovered; the
+    /// journal is only recovered up until the first one.
+    class ActionJournal {
+        public:
+        /// Version 2 added Amend entries, journals of version 1 are still read
+        static constexpr uint32_t version = 2;
+
+        /// Where the journal of a file is kept: [filename].helix-actions
+        static std::filesystem::path getJournalPath (const std::filesystem::path& filename);
+
+        explicit ActionJournal (std::filesystem::path t_path, std::chrono::milliseconds t_sync_interval, IOQueue& t_queue);
+        /// Writes out whatever is still buffered
+        ~ActionJournal ();
+
+        ActionJournal (const ActionJournal&) = delete;
+        ActionJournal& operator= (const ActionJournal&) = delete;
+
+        /// Brings the journal up to date with the actions, including any that were undone or merged into.
+        /// `base_size` is the size of the unmodified file, which is only used when the journal is started.
+        void sync (ActionListLink& actions, size_t base_size);
+
+        /// Writes out everything that is buffered and syncs it to the disk. Can be called from any thread.
+        void flush ();
+
+        /// Starts over with an empty journal, such as once the actions were saved into the file
+        void restart (size_t base_size);
+
+        /// Removes the journal file. It is started again on the next sync.
+        void discard ();
+
+        /// Reads the journal at `path`, returning the actions in it.
+        /// Returns nullopt if there is no usable journal, or it was made for a file of a different size than `base_size`.
+        /// A journal cut off part of the way through (such as by a crash while writing it) gives the actions before
+        /// that point.
+        static std::optional<std::vector<std::unique_ptr<BaseAction>>> read (const std::filesystem::path& path, size_t base_size, std::pmr::memory_resource* resource);
+
+        protected:
+        enum class EntryKind : uint8_t {
+            /// Only the first N journaled actions are still in the list
+            Truncate = 0,
+            /// An action, as its records
+            Action,
+            /// An action that can't be journaled, which nothing after can be recovered past
+            Unrecoverable,
+            /// Records made after the last journaled action that were merged into it (see ActionListLink::getLastMerge),
+            /// so typing into a merged edit doesn't journal the whole edit again for every byte
+            Amend,
+        };
+
+        std::filesystem::path path;
+        std::chrono::milliseconds sync_interval;
+        IOQueue& queue;
+        /// Held while writing to `file`, and while replacing it
+        std::mutex file_mutex;
+        std::ofstream file;
+        bool started = false;
+
+        /// Serials of the journaled actions, in order
+        std::vector<uint64_t> serials;
+        /// ActionListLink::getRevision when last synced
+        uint64_t revision = 0;
+
+        /// Held while using `pending`, `last_flush` or `flush_scheduled`, which flush uses from the queue's thread
+        std::mutex pending_mutex;
+        /// Encoded entries that haven't been written to the file yet
+        std::vector<std::byte> pending;
+        std::chrono::steady_clock::time_point last_flush;
+        /// Whether a flush is scheduled on the queue that will write out `pending`
+        bool flush_scheduled = false;
+
+        void appendEntry (const std::vector<std::byte>& payload);
+        void appendTruncate (size_t keep);
+        void appendAction (const ActionRecord* begin, const ActionRecord* end);
+        void appendAmend (const ActionRecord& record);
+        static void appendRecords (std::vector<std::byte>& payload, const ActionRecord* begin, const ActionRecord* end);
+        /// Reads what appendRecords wrote, as an action for each record. Returns nullopt if they were cut off.
+        static std::optional<std::vector<std::unique_ptr<BaseAction>>> readRecords (const std::byte*& payload, const std::byte* payload_end, std::pmr::memory_resource* resource);
+    };
+} // namespace Helix
@@ -0,0 +1,181 @@
+#include "BlockCache.hpp"
+
+#include <algorithm>
+
+namespace Helix {
+	// ==== BlockCache:Constructors ====
+	BlockCache::BlockCache (CachePolicy t_policy, size_t t_block_size, size_t capacity_bytes) :
+		policy(t_policy), block_size(std::max<size_t>(t_block_size, 1)) {
+		capacity = std::max<size_t>(capacity_bytes / block_size, 1);
+		hand = recent.end();
+	}
+
+	// ==== BlockCache ====
+	const std::vector<std::byte>* BlockCache::find (uint64_t index) {
+		auto iterator = entries.find(index);
+		if (iterator == entries.end()) {
+			stats.misses++;
+			return nullptr;
+		}
+		stats.hits++;
+
+		Entry& entry = iterator->second;
+		switch (policy) {
+			case CachePolicy::LRU:
+				recent.splice(recent.begin(), recent, entry.position);
+				break;
+			case CachePolicy::Clock:
+				entry.referenced = true;
+				break;
+			case CachePolicy::TwoQueue:
+				// Hits in `recent` don't move the block, it has to be evicted and come back to count as reused
+				if (entry.queue == Queue::Frequent) {
+					frequent.splice(frequent.begin(), frequent, entry.position);
+				}
+				break;
+		}
+		return &entry.data;
+	}
+
+	bool BlockCache::contains (uint64_t index) const {
+		return entries.find(index) != entries.end();
+	}
+
+	const std::vector<std::byte>& BlockCache::insert (uint64_t index, std::vector<std::byte>&& data, bool prefetched) {
+		if (entries.size() >= capacity) {
+			evict();
+		}
+		if (prefetched) {
+			stats.prefetches++;
+		}
+
+		Entry entry;
+		entry.data = std::move(data);
+		entry.queue = Queue::Recent;
+		switch (policy) {
+			case CachePolicy::LRU:
+				entry.position = recent.insert(recent.begin(), index);
+				break;
+			case CachePolicy::Clock:
+				// Right behind the hand, so it is the last block the hand gets to
+				entry.position = recent.insert(hand, index);
+				break;
+			case CachePolicy::TwoQueue: {
+				auto ghost = ghost_positions.find(index);
+				if (ghost != ghost_positions.end()) {
+					// It was read again after being evicted, so it's worth keeping around
+					ghosts.erase(ghost->second);
+					ghost_positions.erase(ghost);
+					entry.queue = Queue::Frequent;
+					entry.position = frequent.insert(frequent.begin(), index);
+				} else {
+					entry.position = recent.insert(recent.begin(), index);
+				}
+				break;
+			}
+		}
+
+		return entries.emplace(index, std::move(entry)).first->second.data;
+	}
+
+	void BlockCache::clear () {
+		entries.clear();
+		recent.clear();
+		frequent.clear();
+		ghosts.clear();
+		ghost_positions.clear();
+		hand = recent.end();
+	}
+
+	CachePolicy BlockCache::getPolicy () const {
+		return policy;
+	}
+
+	size_t BlockCache::getBlockSize () const {
+		return block_size;
+	}
+
+	size_t BlockCache::getCapacity () const {
+		return capacity;
+	}
+
+	const CacheStats& BlockCache::getStats () const {
+		return stats;
+	}
+
+	void BlockCache::resetStats () {
+		stats = CacheStats();
+	}
+
+	size_t BlockCache::getRecentCapacity () const {
+		return std::max<size_t>(capacity / 4, 1);
+	}
+
+	size_t BlockCache::getGhostCapacity () const {
+		return std::max<size_t>(capacity / 2, 1);
+	}
+
+	void BlockCache::evict () {
+		if (entries.empty()) {
+			return;
+		}
+
+		uint64_t victim = 0;
+		switch (policy) {
+			case CachePolicy::LRU:
+				victim = recent.back();
+				break;
+			case CachePolicy::Clock:
+				// Go around clearing the referenced bits until finding a block that wasn't used since the last pass
+				while (true) {
+					if (hand == recent.end()) {
+						hand = recent.begin();
+					}
+					Entry& entry = entries.at(*hand);
+					if (!entry.referenced) {
+						victim = *hand;
+						break;
+					}
+					entry.referenced = false;
+					++hand;
+				}
+				break;
+			case CachePolicy::TwoQueue:
+				if (recent.size() > getRecentCapacity() || frequent.empty()) {
+					victim = recent.back();
+					addGhost(victim);
+				} else {
+					victim = frequent.back();
+				}
+				break;
+		}
+
+		erase(victim);
+		stats.evictions++;
+	}
+
+	void BlockCache::erase (uint64_t index) {
+		auto iterator = entries.find(index);
+		if (iterator == entries.end()) {
+			return;
+		}
+
+		Entry& entry = iterator->second;
+		if (entry.queue == Queue::Frequent) {
+			frequent.erase(entry.position);
+		} else if (entry.position == hand) {
+			hand = recent.erase(entry.position);
+		} else {
+			recent.erase(entry.position);
+		}
+		entries.erase(iterator);
+	}
+
+	void BlockCache::addGhost (uint64_t index) {
+		ghost_positions[index] = ghosts.insert(ghosts.begin(), index);
+		while (ghosts.size() > getGhostCapacity()) {
+			ghost_positions.erase(ghosts.back());
+			ghosts.pop_back();
+		}
+	}
+} // namespace Helix
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <list>
+#include <unordered_map>
+
+namespace Helix {
+    /// How a BlockCache picks which block to throw out when it is full
+    enum class CachePolicy {
+        /// Least recently used
+        LRU = 0,
+        /// Second-chance approximation of LRU, which doesn't reorder anything on a hit
+        Clock,
+        /// Blocks only read once (such as by a scan through the whole file) go through a small FIFO queue, and only
+        /// blocks that are read again after leaving it get into the main LRU queue. So a scan can't evict the blocks
+        /// that are actually being reused.
+        TwoQueue,
+    };
+
+    struct CacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        /// Blocks that were read ahead of being asked for
+        uint64_t prefetches = 0;
+    };
+
+    /// Fixed size blocks of a file, keyed by block index, limited to a size in bytes
+    class BlockCache {
+        public:
+        explicit BlockCache (CachePolicy t_policy, size_t t_block_size, size_t capacity_bytes);
+
+        BlockCache (const BlockCache&) = delete;
+        BlockCache& operator= (const BlockCache&) = delete;
+
+        /// The cached block, or nullptr if it isn't cached. Counted as a hit or a miss.
+        const std::vector<std::byte>* find (uint64_t index);
+        /// Whether the block is cached, without counting it as a hit or a miss
+        bool contains (uint64_t index) const;
+        /// Caches the block, evicting others if needed. The block must not already be cached.
+        /// `prefetched` is whether it was read ahead of being asked for, which is only used for the stats.
+        const std::vector<std::byte>& insert (uint64_t index, std::vector<std::byte>&& data, bool prefetched=false);
+
+        /// Forgets every block, such as after the file was changed underneath the cache
+        void clear ();
+
+        CachePolicy getPolicy () const;
+        size_t getBlockSize () const;
+        /// Maximum amount of blocks held at once
+        size_t getCapacity () const;
+
+        const CacheStats& getStats () const;
+        void resetStats ();
+
+        protected:
+        enum class Queue : uint8_t {
+            /// LRU: the only queue. Clock: the ring. TwoQueue: blocks seen once (A1in).
+            Recent,
+            /// TwoQueue: blocks seen again after leaving `recent` (Am)
+            Frequent,
+        };
+
+        struct Entry {
+            std::vector<std::byte> data;
+            Queue queue;
+            std::list<uint64_t>::iterator position;
+            /// Clock: whether the block was used since the hand last passed it
+            bool referenced = false;
+        };
+
+        CachePolicy policy;
+        size_t block_size;
+        size_t capacity;
+
+        std::unordered_map<uint64_t, Entry> entries;
+        /// Most recently inserted (or used, for LRU) at the front
+        std::list<uint64_t> recent;
+        std::list<uint64_t> frequent;
+        /// TwoQueue: indices of blocks that were recently evicted from `recent` (A1out)
+        std::list<uint64_t> ghosts;
+        std::unordered_map<uint64_t, std::list<uint64_t>::iterator> ghost_positions;
+        /// Clock: the next block in `recent` to consider for eviction
+        std::list<uint64_t>::iterator hand;
+
+        CacheStats stats;
+
+        /// TwoQueue: how many blocks `recent` may hold before it is evicted from rather than `frequent`
+        size_t getRecentCapacity () const;
+        /// TwoQueue: how many evicted block indices are remembered
+        size_t getGhostCapacity () const;
+
+        void evict ();
+        void erase (uint64_t index);
+        void addGhost (uint64_t index);
+    };
+} // namespace Helix
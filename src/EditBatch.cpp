@@ -0,0 +1,159 @@
+#include "EditBatch.hpp"
+
+#include <algorithm>
+
+namespace Helix {
+	namespace {
+		/// Adds the edits collected in `run` to `result`, one action per contiguous range, and empties `run`
+		void flushEdits (EditIndex& run, std::vector<std::unique_ptr<BaseAction>>& result, std::pmr::memory_resource* resource) {
+			if (run.getPieceCount() == 0) {
+				return;
+			}
+
+			AlphaFile::Natural start = 0;
+			std::vector<std::byte> values;
+			AlphaFile::Natural position = 0;
+			run.forEachPiece(0, PieceTable::unbounded_length, [&] (const Piece& piece) {
+				if (piece.source == Piece::Source::Buffer) {
+					// Ranges that were written separately but touch are joined into one edit
+					if (!values.empty() && start + values.size() != position) {
+						result.push_back(std::make_unique<EditAction>(start, std::move(values), resource));
+						values = std::vector<std::byte>();
+					}
+					if (values.empty()) {
+						start = position;
+					}
+					const std::byte* piece_data = run.getBufferData(piece);
+					values.insert(values.end(), piece_data, piece_data + piece.length);
+				}
+				position += piece.length;
+				return true;
+			});
+			if (!values.empty()) {
+				result.push_back(std::make_unique<EditAction>(start, std::move(values), resource));
+			}
+			run.clear();
+		}
+	}
+
+	// ==== EditBatch ====
+	void EditBatch::edit (AlphaFile::Natural position, std::byte value) {
+		operations.push_back(Operation{ActionRecord::Kind::Edit, position, 1, InsertionAction::insertion_value, data.size()});
+		data.push_back(value);
+	}
+
+	void EditBatch::edit (AlphaFile::Natural position, std::vector<std::byte>&& values) {
+		if (values.empty()) {
+			return;
+		}
+		operations.push_back(Operation{ActionRecord::Kind::Edit, position, values.size(), InsertionAction::insertion_value, data.size()});
+		data.insert(data.end(), values.begin(), values.end());
+	}
+
+	void EditBatch::insert (AlphaFile::Natural position, size_t amount, std::byte pattern) {
+		if (amount == 0) {
+			return;
+		}
+		operations.push_back(Operation{ActionRecord::Kind::Insertion, position, amount, pattern});
+	}
+
+	void EditBatch::deletion (AlphaFile::Natural position, size_t amount) {
+		if (amount == 0) {
+			return;
+		}
+		operations.push_back(Operation{ActionRecord::Kind::Deletion, position, amount});
+	}
+
+	size_t EditBatch::getOperationCount () const {
+		return operations.size();
+	}
+
+	bool EditBatch::empty () const {
+		return operations.empty();
+	}
+
+	bool EditBatch::hasInsertions () const {
+		return std::any_of(operations.begin(), operations.end(), [] (const Operation& operation) {
+			return operation.kind == ActionRecord::Kind::Insertion;
+		});
+	}
+
+	bool EditBatch::hasDeletions () const {
+		return std::any_of(operations.begin(), operations.end(), [] (const Operation& operation) {
+			return operation.kind == ActionRecord::Kind::Deletion;
+		});
+	}
+
+	std::optional<std::pair<AlphaFile::Natural, AlphaFile::Natural>> EditBatch::getRange () const {
+		if (operations.empty()) {
+			return std::nullopt;
+		}
+
+		AlphaFile::Natural start = operations.front().position;
+		AlphaFile::Natural end = operations.front().position + operations.front().amount;
+		for (const Operation& operation : operations) {
+			start = std::min(start, operation.position);
+			end = std::max(end, operation.position + operation.amount);
+		}
+		return std::make_pair(start, end);
+	}
+
+	std::vector<std::unique_ptr<BaseAction>> EditBatch::build (std::pmr::memory_resource* resource) const {
+		std::vector<std::unique_ptr<BaseAction>> result;
+		EditIndex run;
+		// The last insertion/deletion, held back in case the next one can be merged into it
+		std::optional<Operation> pending;
+
+		const auto flushPending = [&] () {
+			if (!pending.has_value()) {
+				return;
+			}
+			const Operation operation = pending.value();
+			pending.reset();
+			if (operation.kind == ActionRecord::Kind::Deletion) {
+				result.push_back(std::make_unique<DeletionAction>(operation.position, operation.amount));
+				return;
+			}
+			result.push_back(std::make_unique<InsertionAction>(operation.position, operation.amount));
+			if (operation.pattern != InsertionAction::insertion_value) {
+				// The fill goes into the next run of edits, so edits over the inserted bytes are merged with it
+				const std::vector<std::byte> fill(operation.amount, operation.pattern);
+				run.write(operation.position, fill.data(), fill.size());
+			}
+		};
+
+		for (const Operation& operation : operations) {
+			if (operation.kind == ActionRecord::Kind::Edit) {
+				flushPending();
+				run.write(operation.position, data.data() + operation.data_offset, operation.amount);
+				continue;
+			}
+
+			if (pending.has_value() && pending->kind == operation.kind) {
+				Operation& previous = pending.value();
+				if (operation.kind == ActionRecord::Kind::Insertion && operation.pattern == previous.pattern &&
+					operation.position >= previous.position && operation.position <= previous.position + previous.amount) {
+					// Inserting within (or at either end of) the bytes just inserted
+					previous.amount += operation.amount;
+					continue;
+				} else if (operation.kind == ActionRecord::Kind::Deletion && operation.position == previous.position) {
+					// Deleting the bytes that moved into the place of the ones just deleted
+					previous.amount += operation.amount;
+					continue;
+				} else if (operation.kind == ActionRecord::Kind::Deletion && operation.position + operation.amount == previous.position) {
+					// Deleting the bytes right before the ones just deleted, such as backspacing
+					previous.position = operation.position;
+					previous.amount += operation.amount;
+					continue;
+				}
+			}
+			flushPending();
+			flushEdits(run, result, resource);
+			pending = operation;
+		}
+		flushPending();
+		flushEdits(run, result, resource);
+
+		return result;
+	}
+} // namespace Helix
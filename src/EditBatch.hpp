@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <memory_resource>
+
+#include "Helix.hpp"
+
+namespace Helix {
+    /// Collects edits, insertions and deletions to be made as a single action by Helix::commitBatch, for callers
+    /// that make many changes at once (such as patching every relocation in a file).
+    /// Each change is positioned as if the ones before it in the batch were already made, same as calling
+    /// Helix::edit/insert/deletion one after another.
+    ///
+    /// When the batch is committed, each run of edits between insertions/deletions is sorted and merged (later edits
+    /// winning where they overlap) into as few edit actions as there are separate ranges, which takes
+    /// O(n log n) rather than adding an action (and replaying through it) per edit.
+    class EditBatch {
+        public:
+        void edit (AlphaFile::Natural position, std::byte value);
+        void edit (AlphaFile::Natural position, std::vector<std::byte>&& values);
+        void insert (AlphaFile::Natural position, size_t amount, std::byte pattern=InsertionAction::insertion_value);
+        void deletion (AlphaFile::Natural position, size_t amount);
+
+        /// Amount of changes added to the batch
+        size_t getOperationCount () const;
+        bool empty () const;
+        bool hasInsertions () const;
+        bool hasDeletions () const;
+
+        /// The lowest position a change starts at and the highest position one ends at, if there are any changes.
+        /// Positions are as each change was given, so this is only a hint once insertions/deletions shift them.
+        std::optional<std::pair<AlphaFile::Natural, AlphaFile::Natural>> getRange () const;
+
+        /// The normalized actions making up the batch, in the order they apply.
+        /// Back to back insertions/deletions that join up are merged as well, such as deleting the same position
+        /// repeatedly. Edit payloads are stored in `resource`, such as the action list's arena.
+        std::vector<std::unique_ptr<BaseAction>> build (std::pmr::memory_resource* resource) const;
+
+        protected:
+        struct Operation {
+            ActionRecord::Kind kind;
+            AlphaFile::Natural position;
+            size_t amount;
+            /// Insertion: what the inserted bytes are filled with
+            std::byte pattern = InsertionAction::insertion_value;
+            /// Edit: where the edited bytes start in `data`
+            size_t data_offset = 0;
+        };
+
+        std::vector<Operation> operations;
+        /// The bytes of every edit, one after another
+        std::vector<std::byte> data;
+    };
+} // namespace Helix
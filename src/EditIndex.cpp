@@ -0,0 +1,87 @@
+#include "EditIndex.hpp"
+
+namespace Helix {
+	// ==== EditIndex:Constructors ====
+	EditIndex::EditIndex () {}
+
+	// ==== EditIndex:Public ====
+	void EditIndex::clear () {
+		ranges.clear();
+		buffer.clear();
+	}
+
+	std::variant<std::byte, AlphaFile::Natural> EditIndex::lookup (AlphaFile::Natural position) const {
+		auto iterator = findCovering(position);
+		if (iterator != ranges.end() && iterator->first <= position) {
+			return buffer[iterator->second.offset + (position - iterator->first)];
+		}
+		return position;
+	}
+
+	void EditIndex::write (AlphaFile::Natural position, const std::byte* data, size_t length) {
+		if (length == 0) {
+			return;
+		}
+
+		const AlphaFile::Natural end = position + length;
+		const size_t offset = buffer.size();
+		buffer.insert(buffer.end(), data, data + length);
+
+		// Cut the range that starts before the write, keeping the part in front of it (and after it, if the write is
+		// entirely inside of it)
+		auto iterator = ranges.lower_bound(position);
+		if (iterator != ranges.begin()) {
+			auto previous = std::prev(iterator);
+			const AlphaFile::Natural previous_end = previous->first + previous->second.length;
+			if (previous_end > position) {
+				previous->second.length = position - previous->first;
+				if (previous_end > end) {
+					ranges.emplace(end, Range{previous_end - end, previous->second.offset + (end - previous->first)});
+				}
+			}
+		}
+
+		// Remove the ranges starting inside of the write, keeping the part of the last one that is after it
+		iterator = ranges.lower_bound(position);
+		while (iterator != ranges.end() && iterator->first < end) {
+			const AlphaFile::Natural range_end = iterator->first + iterator->second.length;
+			if (range_end > end) {
+				const Range tail{range_end - end, iterator->second.offset + (end - iterator->first)};
+				ranges.erase(iterator);
+				ranges.emplace(end, tail);
+				break;
+			}
+			iterator = ranges.erase(iterator);
+		}
+
+		// Consecutive writes (such as typing) extend the previous range rather than making a new one
+		iterator = ranges.lower_bound(position);
+		if (iterator != ranges.begin()) {
+			auto previous = std::prev(iterator);
+			if (
+				previous->first + previous->second.length == position &&
+				previous->second.offset + previous->second.length == offset
+			) {
+				previous->second.length += length;
+				return;
+			}
+		}
+		ranges.emplace_hint(iterator, position, Range{length, offset});
+	}
+
+	size_t EditIndex::getPieceCount () const {
+		return ranges.size();
+	}
+
+	// ==== EditIndex:Internal ====
+	std::map<AlphaFile::Natural, EditIndex::Range>::const_iterator EditIndex::findCovering (AlphaFile::Natural position) const {
+		auto iterator = ranges.upper_bound(position);
+		if (iterator != ranges.begin()) {
+			auto previous = std::prev(iterator);
+			if (previous->first + previous->second.length > position) {
+				return previous;
+			}
+		}
+		return iterator;
+	}
+} // namespace Helix
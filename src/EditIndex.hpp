@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <variant>
+#include <map>
+#include <algorithm>
+
+#include <AlphaFile.hpp>
+
+#include "PieceTable.hpp"
+
+namespace Helix {
+    /// Index of edited ranges for sessions where positions never shift (no insertions or deletions).
+    /// Since every position stays where it is in the file, a read only has to find the most recent edit covering it,
+    /// which is a lookup in an ordered map of disjoint ranges. Everything that isn't edited is read from the file at
+    /// the same position.
+    class EditIndex {
+        public:
+        explicit EditIndex ();
+
+        void clear ();
+
+        /// Same as PieceTable::lookup
+        std::variant<std::byte, AlphaFile::Natural> lookup (AlphaFile::Natural position) const;
+
+        /// Overwrites [position, position + length) with data
+        void write (AlphaFile::Natural position, const std::byte* data, size_t length);
+
+        /// Same as PieceTable::forEachPiece, with unedited gaps given as file pieces
+        template<typename Func>
+        void forEachPiece (AlphaFile::Natural position, size_t amount, Func&& func) const {
+            auto iterator = findCovering(position);
+
+            while (amount != 0) {
+                Piece piece;
+                if (iterator != ranges.end() && iterator->first <= position) {
+                    const size_t inner = position - iterator->first;
+                    piece.source = Piece::Source::Buffer;
+                    piece.offset = iterator->second.offset + inner;
+                    piece.length = std::min(amount, iterator->second.length - inner);
+                    ++iterator;
+                } else {
+                    // Gap up until the next edit
+                    piece.source = Piece::Source::File;
+                    piece.offset = position;
+                    piece.length = amount;
+                    if (iterator != ranges.end()) {
+                        piece.length = std::min(amount, iterator->first - position);
+                    }
+                }
+
+                if (!func(piece)) {
+                    return;
+                }
+                position += piece.length;
+                amount -= piece.length;
+            }
+        }
+
+        /// The bytes of a piece with Source::Buffer
+        const std::byte* getBufferData (const Piece& piece) const {
+            return buffer.data() + piece.offset;
+        }
+
+        /// Amount of edited ranges
+        size_t getPieceCount () const;
+
+        protected:
+        struct Range {
+            size_t length;
+            /// Where the range's bytes start in `buffer`
+            size_t offset;
+        };
+
+        /// Keyed by the start of the range, ranges never overlap
+        std::map<AlphaFile::Natural, Range> ranges;
+        /// Holds the data of every write
+        std::vector<std::byte> buffer;
+
+        /// The range containing position, or otherwise the first range after it
+        std::map<AlphaFile::Natural, Range>::const_iterator findCovering (AlphaFile::Natural position) const;
+    };
+} // namespace Helix
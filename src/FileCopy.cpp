@@ -0,0 +1,138 @@
+#include "FileCopy.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <stdexcept>
+
+#if defined(__linux__)
+#define HELIX_HAS_LINUX_COPY
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace Helix {
+	namespace {
+		std::optional<CopyStrategy> copyBuffered (const std::filesystem::path& source_path, const std::filesystem::path& destination_path, size_t chunk_size, const CopyStep& step) {
+			std::ifstream source(source_path, std::ios::binary);
+			std::ofstream destination(destination_path, std::ios::binary | std::ios::trunc);
+			if (!source.is_open() || !destination.is_open()) {
+				throw std::runtime_error("Failed to open the files to copy.");
+			}
+
+			std::vector<char> buffer;
+			buffer.resize(chunk_size);
+
+			size_t copied = 0;
+			while (source) {
+				if (!step(copied)) {
+					return std::nullopt;
+				}
+
+				source.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+				const std::streamsize amount = source.gcount();
+				if (source.bad()) {
+					throw std::runtime_error("Failed to read the file to copy.");
+				}
+				destination.write(buffer.data(), amount);
+				if (destination.fail()) {
+					throw std::runtime_error("Failed to write the copy of the file.");
+				}
+				copied += static_cast<size_t>(amount);
+			}
+
+			// Anything still buffered is written (and checked) as it is closed
+			destination.close();
+			if (destination.fail()) {
+				throw std::runtime_error("Failed to write the copy of the file.");
+			}
+			step(copied);
+			return CopyStrategy::Buffered;
+		}
+
+#ifdef HELIX_HAS_LINUX_COPY
+		/// Closes the descriptor when it goes out of scope
+		struct Descriptor {
+			int value;
+
+			explicit Descriptor (int t_value) : value(t_value) {}
+			~Descriptor () {
+				if (value >= 0) {
+					::close(value);
+				}
+			}
+
+			Descriptor (const Descriptor&) = delete;
+			Descriptor& operator= (const Descriptor&) = delete;
+		};
+
+		/// Copies with a reflink or copy_file_range, with `result` set the same as copyFile's return value.
+		/// Returns false if neither is supported for these files, in which case nothing was copied yet.
+		bool copyKernel (const std::filesystem::path& source_path, const std::filesystem::path& destination_path, size_t chunk_size, const CopyStep& step, std::optional<CopyStrategy>& result) {
+			Descriptor source(::open(source_path.c_str(), O_RDONLY));
+			if (source.value < 0) {
+				throw std::runtime_error("Failed to open the file to copy.");
+			}
+			Descriptor destination(::open(destination_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+			if (destination.value < 0) {
+				throw std::runtime_error("Failed to create the copy of the file.");
+			}
+
+			struct stat source_stat;
+			if (fstat(source.value, &source_stat) != 0) {
+				return false;
+			}
+			const size_t size = static_cast<size_t>(source_stat.st_size);
+			// Keep the permissions of the original, the same as std::filesystem::copy_file
+			fchmod(destination.value, source_stat.st_mode & 07777);
+
+#ifdef FICLONE
+			if (ioctl(destination.value, FICLONE, source.value) == 0) {
+				step(size);
+				result = CopyStrategy::Reflink;
+				return true;
+			}
+#endif
+
+			size_t copied = 0;
+			while (copied < size) {
+				if (!step(copied)) {
+					result = std::nullopt;
+					return true;
+				}
+
+				const ssize_t amount = copy_file_range(source.value, nullptr, destination.value, nullptr, std::min(chunk_size, size - copied), 0);
+				if (amount < 0) {
+					if (copied == 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+						// Not supported between these files, so let the caller copy it the slow way
+						return false;
+					}
+					throw std::runtime_error("Failed to copy the file.");
+				} else if (amount == 0) {
+					// The file got shorter while copying it
+					break;
+				}
+				copied += static_cast<size_t>(amount);
+			}
+			step(copied);
+			result = CopyStrategy::CopyFileRange;
+			return true;
+		}
+#endif
+	}
+
+	std::optional<CopyStrategy> copyFile (const std::filesystem::path& source, const std::filesystem::path& destination, size_t chunk_size, const CopyStep& step) {
+		chunk_size = std::max<size_t>(chunk_size, 1);
+#ifdef HELIX_HAS_LINUX_COPY
+		std::optional<CopyStrategy> result;
+		if (copyKernel(source, destination, chunk_size, step, result)) {
+			return result;
+		}
+#endif
+		return copyBuffered(source, destination, chunk_size, step);
+	}
+} // namespace Helix
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <functional>
+#include <filesystem>
+
+namespace Helix {
+    /// How copyFile copied the file, from fastest to slowest
+    enum class CopyStrategy {
+        /// The copy shares the original's blocks until either is written to (FICLONE on btrfs/XFS), so nothing is
+        /// actually read or written
+        Reflink = 0,
+        /// Copied by the kernel (copy_file_range), without going through our memory. Some filesystems do this on
+        /// the server or device.
+        CopyFileRange,
+        /// Read and written through a buffer
+        Buffered,
+    };
+
+    /// Called with the amount of bytes copied so far. Returns false to stop copying.
+    using CopyStep = std::function<bool(size_t copied)>;
+
+    /// Copies `source` to `destination` (which is created or truncated), using the fastest strategy that works.
+    /// `step` is called between chunks of `chunk_size` bytes. Returns the strategy that was used, or nullopt if `step`
+    /// stopped it, in which case `destination` is left partially written.
+    /// Throws std::runtime_error if either file can't be opened, or reading or writing fails part of the way.
+    std::optional<CopyStrategy> copyFile (const std::filesystem::path& source, const std::filesystem::path& destination, size_t chunk_size, const CopyStep& step);
+} // namespace Helix
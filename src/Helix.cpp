@@ -1,74 +1,735 @@
 #include "Helix.hpp"
+#include "ActionJournal.hpp"
+#include "SessionFile.hpp"
+#include "EditBatch.hpp"
 
 namespace Helix {
+	// ==== ActionRecord ====
+	ActionRecord ActionRecord::edit (AlphaFile::Natural t_position, const std::byte* t_data, size_t t_amount) {
+		ActionRecord record;
+		record.kind = Kind::Edit;
+		record.position = t_position;
+		record.amount = t_amount;
+		record.data = t_data;
+		return record;
+	}
+	ActionRecord ActionRecord::insertion (AlphaFile::Natural t_position, size_t t_amount) {
+		ActionRecord record;
+		record.kind = Kind::Insertion;
+		record.position = t_position;
+		record.amount = t_amount;
+		record.data = nullptr;
+		return record;
+	}
+	ActionRecord ActionRecord::deletion (AlphaFile::Natural t_position, size_t t_amount) {
+		ActionRecord record;
+		record.kind = Kind::Deletion;
+		record.position = t_position;
+		record.amount = t_amount;
+		record.data = nullptr;
+		return record;
+	}
+	ActionRecord ActionRecord::opaque (BaseAction* t_action) {
+		ActionRecord record;
+		record.kind = Kind::Opaque;
+		record.position = 0;
+		record.amount = 0;
+		record.action = t_action;
+		return record;
+	}
+
+	ptrdiff_t ActionRecord::getSizeDifference () const {
+		switch (kind) {
+			case Kind::Edit:
+				return 0;
+			case Kind::Insertion:
+				return static_cast<ptrdiff_t>(amount);
+			case Kind::Deletion:
+				return -static_cast<ptrdiff_t>(amount);
+			case Kind::Opaque:
+				return action->getSizeDifference();
+		}
+		return 0;
+	}
+
+	std::variant<std::byte, AlphaFile::Natural> ActionRecord::reversePosition (AlphaFile::Natural read_position) const {
+		switch (kind) {
+			case Kind::Edit:
+				if (read_position >= position && read_position < position + amount) {
+					return data[read_position - position];
+				}
+				return read_position;
+			case Kind::Insertion:
+				if (read_position >= position && read_position < position + amount) {
+					return InsertionAction::insertion_value;
+				} else if (read_position >= position) {
+					return read_position - amount;
+				}
+				return read_position;
+			case Kind::Deletion:
+				if (read_position >= position) {
+					return read_position + amount;
+				}
+				return read_position;
+			case Kind::Opaque:
+				return action->reversePosition(read_position);
+		}
+		return read_position;
+	}
+
+	void ActionRecord::applyTo (PieceTable& table) const {
+		switch (kind) {
+			case Kind::Edit:
+				table.write(position, data, amount);
+				break;
+			case Kind::Insertion:
+				table.insert(position, amount, InsertionAction::insertion_value);
+				break;
+			case Kind::Deletion:
+				table.erase(position, amount);
+				break;
+			case Kind::Opaque:
+				throw std::logic_error("Opaque action records can't be applied to a piece table.");
+		}
+	}
+
+	// ==== SaveCancellation ====
+	void SaveCancellation::cancel () {
+		cancelled = true;
+	}
+
+	bool SaveCancellation::isCancelled () const {
+		return cancelled;
+	}
+
+	// ==== SaveControl ====
+	void SaveControl::report (SavePhase phase, size_t done, size_t total) const {
+		if (progress) {
+			progress(SaveProgress{phase, done, total});
+		}
+	}
+
+	bool SaveControl::isCancelled () const {
+		return cancellation && cancellation->isCancelled();
+	}
+
+	// ==== HelixStats ====
+	double HelixStats::getAverageRecordsWalked () const {
+		if (action_lookups == 0) {
+			return 0.0;
+		}
+		return static_cast<double>(records_walked) / static_cast<double>(action_lookups);
+	}
+
+	uint64_t HelixStats::getBytesWritten (SavePhase phase) const {
+		return bytes_written.at(static_cast<size_t>(phase));
+	}
+
+	// ==== ActionListLink ====
+	std::variant<std::byte, AlphaFile::Natural> ActionListLink::readFromStorage (AlphaFile::Natural natural_position) {
+		syncIndex();
+
+		read_counters.lookups.add();
+		const size_t tail_start = getRecordStart(indexed_count);
+		for (size_t index = records.size(); index > tail_start; index--) {
+			std::variant<std::byte, AlphaFile::Natural> result = records[index - 1].reversePosition(natural_position);
+
+			if (std::holds_alternative<std::byte>(result)) {
+				read_counters.records_walked.add(records.size() - index + 1);
+				return std::get<std::byte>(result);
+			} else {
+				natural_position = std::get<AlphaFile::Natural>(result);
+			}
+		}
+		if (records.size() != tail_start) {
+			read_counters.records_walked.add(records.size() - tail_start);
+		}
+		if (edit_only) {
+			return edits.lookup(natural_position);
+		}
+		return pieces.lookup(natural_position);
+	}
+
+	const std::byte* ActionListLink::getPieceData (const Piece& piece) const {
+		if (edit_only) {
+			return edits.getBufferData(piece);
+		}
+		return pieces.getBufferData(piece);
+	}
+
+	size_t ActionListLink::getPieceCount () {
+		syncIndex();
+		if (edit_only) {
+			return edits.getPieceCount();
+		}
+		return pieces.getPieceCount();
+	}
+
+	void ActionListLink::setEditOnly (bool value) {
+		edit_only = value;
+		// Rebuild in whichever index is now used
+		pieces.clear();
+		edits.clear();
+		indexed_count = 0;
+	}
+
+	size_t ActionListLink::getSizeDifference (size_t value) {
+		// TODO: also possibly make so the value is passed to it instead of merely adding to it
+		//       that would work better than returning ptrdiff_t, and allow more complicate size differences
+		syncRecords();
+		const ptrdiff_t difference = size_totals.empty() ? 0 : size_totals.back();
+		if (difference < 0 && static_cast<size_t>(-difference) > value) {
+			return 0;
+		}
+		return value + static_cast<size_t>(difference);
+	}
+
+	void ActionListLink::save (AlphaFile::BasicFile& file, const SaveOptions& options) {
+		save(file, options, [] (size_t, size_t) {
+			return true;
+		});
+	}
+
+	bool ActionListLink::save (AlphaFile::BasicFile& file, const SaveOptions& options, const std::function<bool(size_t done, size_t total)>& step) {
+		std::vector<std::byte> edit_buffer;
+		SaveOptions buffered_options = options;
+		if (buffered_options.edit_buffer == nullptr) {
+			buffered_options.edit_buffer = &edit_buffer;
+		}
+		const size_t total = this->data.size();
+		for (size_t index = 0; index < total; index++) {
+			if (!step(index, total)) {
+				return false;
+			}
+			this->data[index]->save(file, buffered_options);
+		}
+		step(total, total);
+		return true;
+	}
+
+	void ActionListLink::setCoalescing (bool value, std::optional<std::chrono::steady_clock::duration> interval) {
+		coalescing = value;
+		coalesce_interval = interval;
+		breakCoalescing();
+	}
+
+	void ActionListLink::breakCoalescing () {
+		coalesce_target = nullptr;
+		coalesce_kind = CoalesceKind::None;
+	}
+
+	void ActionListLink::addEdit (AlphaFile::Natural position, std::vector<std::byte>&& values) {
+		if (EditAction* target = static_cast<EditAction*>(getCoalesceTarget(CoalesceKind::Edit))) {
+			const AlphaFile::Natural target_end = target->position + target->data.size();
+			// Overlapping or touching
+			if (position <= target_end && position + values.size() >= target->position) {
+				const AlphaFile::Natural start = std::min(target->position, position);
+				const AlphaFile::Natural end = std::max(target_end, position + values.size());
+
+				if (end - start <= coalesce_max_edit_size) {
+					const bool indexed = isTargetIndexed();
+
+					// Whatever is in front of the old data, or after it, is covered by the new values
+					target->data.insert(target->data.begin(), static_cast<size_t>(target->position - start), std::byte(0x00));
+					target->data.resize(static_cast<size_t>(end - start));
+					target->position = start;
+					std::copy(values.begin(), values.end(), target->data.begin() + static_cast<ptrdiff_t>(position - start));
+					last_merge = ActionRecord::edit(position, target->data.data() + (position - start), values.size());
+
+					refreshTargetRecords();
+					if (indexed) {
+						indexRecord(ActionRecord::edit(position, values.data(), values.size()));
+					}
+					return;
+				}
+			}
+		}
+
+		addCoalescable(std::make_unique<EditAction>(position, std::move(values), arena.get()), CoalesceKind::Edit);
+	}
+
+	void ActionListLink::addInsertion (AlphaFile::Natural position, size_t amount) {
+		if (InsertionAction* target = static_cast<InsertionAction*>(getCoalesceTarget(CoalesceKind::Insertion))) {
+			// Inserting anywhere inside of (or at either end of) an insertion just makes it larger, as it's all
+			// the same value
+			if (position >= target->position && position <= target->position + target->amount) {
+				const bool indexed = isTargetIndexed();
+				target->amount += amount;
+				last_merge = ActionRecord::insertion(position, amount);
+
+				refreshTargetRecords();
+				if (indexed) {
+					indexRecord(ActionRecord::insertion(position, amount));
+				}
+				return;
+			}
+		}
+
+		addCoalescable(std::make_unique<InsertionAction>(position, amount), CoalesceKind::Insertion);
+	}
+
+	void ActionListLink::addDeletion (AlphaFile::Natural position, size_t amount) {
+		if (DeletionAction* target = static_cast<DeletionAction*>(getCoalesceTarget(CoalesceKind::Deletion))) {
+			// Deleting at the same position (delete key), or right before it (backspace)
+			if (position == target->position || position + amount == target->position) {
+				const bool indexed = isTargetIndexed();
+				target->position = position;
+				target->amount += amount;
+				last_merge = ActionRecord::deletion(position, amount);
+
+				refreshTargetRecords();
+				if (indexed) {
+					indexRecord(ActionRecord::deletion(position, amount));
+				}
+				return;
+			}
+		}
+
+		addCoalescable(std::make_unique<DeletionAction>(position, amount), CoalesceKind::Deletion);
+	}
+
+	void ActionListLink::clear () {
+		// TODO: undoing past a save would be really nice to have
+		list.clear();
+
+		// Any actions left would still point into the arena
+		if (this->data.empty()) {
+			arena->release();
+		}
+	}
+
+	void ActionListLink::replace (std::vector<std::unique_ptr<BaseAction>>&& new_actions, std::unique_ptr<ActionArena>&& new_arena) {
+		list.clear();
+		// Only once the actions using the old arena are gone
+		arena = std::move(new_arena);
+		breakCoalescing();
+		for (std::unique_ptr<BaseAction>& action : new_actions) {
+			addAction(std::move(action));
+		}
+	}
+
+	bool ActionListLink::collectEdits (EditIndex& index) {
+		syncRecords();
+		for (const ActionRecord& record : records) {
+			if (record.kind != ActionRecord::Kind::Edit) {
+				return false;
+			}
+			index.write(record.position, record.data, record.amount);
+		}
+		return true;
+	}
+
+	ActionListLink::ReadCounters& ActionListLink::getReadCounters () {
+		return read_counters;
+	}
+
+	size_t ActionListLink::getRecordMemory () const {
+		return records.capacity() * sizeof(ActionRecord) +
+			record_offsets.capacity() * sizeof(size_t) +
+			record_serials.capacity() * sizeof(uint64_t);
+	}
+
+	size_t ActionListLink::getActionCount () const {
+		return this->data.size();
+	}
+
+	uint64_t ActionListLink::getActionSerial (size_t action_index) const {
+		return this->data.at(action_index)->serial;
+	}
+
+	std::pair<const ActionRecord*, const ActionRecord*> ActionListLink::getActionRecords (size_t action_index) {
+		syncRecords();
+		const ActionRecord* base = records.data();
+		return {base + getRecordStart(action_index), base + getRecordStart(action_index + 1)};
+	}
+
+	uint64_t ActionListLink::getRevision () const {
+		return revision;
+	}
+
+	const std::optional<ActionRecord>& ActionListLink::getLastMerge () const {
+		return last_merge;
+	}
+
+	std::optional<uint64_t> ActionListLink::getLastSerial () const {
+		if (this->data.empty()) {
+			return std::nullopt;
+		}
+		return this->data.back()->serial;
+	}
+
+	ActionArena& ActionListLink::getArena () {
+		return *arena;
+	}
+
+	BaseAction* ActionListLink::getCoalesceTarget (CoalesceKind kind) {
+		if (!coalescing) {
+			return nullptr;
+		}
+
+		bool paused = false;
+		if (coalesce_interval.has_value()) {
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			paused = now - coalesce_time > coalesce_interval.value();
+			// Whether or not it's merged, the next action's pause is counted from this one
+			coalesce_time = now;
+		}
+		if (
+			paused ||
+			coalesce_kind != kind ||
+			this->data.empty() ||
+			this->data.back()->serial != coalesce_serial
+		) {
+			return nullptr;
+		}
+		return coalesce_target;
+	}
+
+	bool ActionListLink::isTargetIndexed () {
+		syncIndex();
+		return indexed_count == this->data.size();
+	}
+
+	void ActionListLink::refreshTargetRecords () {
+		revision++;
+		// The target is the last action, so its records are the last ones
+		if (record_serials.size() == this->data.size()) {
+			records.resize(record_offsets.back());
+			coalesce_target->appendRecords(records);
+			size_totals.pop_back();
+			pushSizeTotal(record_offsets.back());
+		}
+	}
+
+	void ActionListLink::addCoalescable (std::unique_ptr<BaseAction>&& action, CoalesceKind kind) {
+		coalesce_target = action.get();
+		coalesce_serial = action->serial;
+		coalesce_kind = kind;
+		addAction(std::move(action));
+	}
+
+	void ActionListLink::syncRecords () {
+		size_t valid = std::min(record_serials.size(), this->data.size());
+		while (valid > 0 && record_serials[valid - 1] != this->data[valid - 1]->serial) {
+			valid--;
+		}
+
+		if (valid < record_serials.size()) {
+			records.resize(record_offsets[valid]);
+			record_offsets.resize(valid);
+			record_serials.resize(valid);
+			size_totals.resize(valid);
+		}
+
+		for (size_t index = valid; index < this->data.size(); index++) {
+			const size_t record_start = records.size();
+			record_offsets.push_back(record_start);
+			record_serials.push_back(this->data[index]->serial);
+			this->data[index]->appendRecords(records);
+			pushSizeTotal(record_start);
+		}
+	}
+
+	void ActionListLink::pushSizeTotal (size_t record_start) {
+		ptrdiff_t total = size_totals.empty() ? 0 : size_totals.back();
+		for (size_t index = record_start; index < records.size(); index++) {
+			total += records[index].getSizeDifference();
+		}
+		size_totals.push_back(total);
+	}
+
+	void ActionListLink::syncIndex () {
+		syncRecords();
+
+		if (
+			indexed_count > this->data.size() ||
+			(indexed_count != 0 && this->data[indexed_count - 1]->serial != indexed_serial)
+		) {
+			pieces.clear();
+			edits.clear();
+			indexed_count = 0;
+		}
+
+		while (indexed_count < this->data.size()) {
+			const size_t start = getRecordStart(indexed_count);
+			const size_t end = getRecordStart(indexed_count + 1);
+
+			const bool indexable = std::all_of(records.begin() + static_cast<ptrdiff_t>(start), records.begin() + static_cast<ptrdiff_t>(end), [this] (const ActionRecord& record) {
+				return isIndexable(record);
+			});
+			if (!indexable) {
+				break;
+			}
+
+			for (size_t index = start; index < end; index++) {
+				indexRecord(records[index]);
+			}
+			indexed_serial = this->data[indexed_count]->serial;
+			indexed_count++;
+		}
+	}
+
+	bool ActionListLink::isIndexable (const ActionRecord& record) const {
+		if (edit_only) {
+			return record.kind == ActionRecord::Kind::Edit;
+		}
+		return record.kind != ActionRecord::Kind::Opaque;
+	}
+
+	void ActionListLink::indexRecord (const ActionRecord& record) {
+		if (edit_only) {
+			edits.write(record.position, record.data, record.amount);
+		} else {
+			record.applyTo(pieces);
+		}
+	}
+
+	size_t ActionListLink::getRecordStart (size_t action_index) const {
+		if (action_index < record_offsets.size()) {
+			return record_offsets[action_index];
+		}
+		return records.size();
+	}
+
 	// ==== Helix:Constructors ====
 	Helix::Helix (MlActions::ActionList& action_list, std::filesystem::path t_filename, AlphaFile::OpenFlags t_flags, Flags t_hflags) :
-		actions(action_list), file(t_hflags.block_size, t_hflags.max_block_count),
-		mode_info(t_hflags.mode_info) {
-		file.getUnderlyingFile().setStart(mode_info.getStart());
-		file.getUnderlyingFile().setEnd(mode_info.getEnd());
-		file.open(t_flags, t_filename);
+		actions(action_list), storage(createStorage(t_filename, t_flags, t_hflags)),
+		save_strategy(t_hflags.save_strategy), in_place_save(t_hflags.in_place_save), save_chunk_size(t_hflags.save_chunk_size), mode_info(t_hflags.mode_info) {
+		initActions(t_hflags);
 	}
 
 	Helix::Helix (MlActions::ActionList& action_list, std::filesystem::path t_filename, Flags t_hflags) :
-		actions(action_list), file(t_hflags.block_size, t_hflags.max_block_count),
-		mode_info(t_hflags.mode_info) {
-		file.getUnderlyingFile().setStart(mode_info.getStart());
-		file.getUnderlyingFile().setEnd(mode_info.getEnd());
-		file.open(AlphaFile::OpenFlags(), t_filename);
+		Helix(action_list, t_filename, AlphaFile::OpenFlags(), t_hflags) {}
+
+	Helix::Helix (MlActions::ActionList& action_list, std::unique_ptr<Storage>&& t_storage, Flags t_hflags) :
+		actions(action_list), storage(std::move(t_storage)),
+		save_strategy(t_hflags.save_strategy), in_place_save(t_hflags.in_place_save), save_chunk_size(t_hflags.save_chunk_size), mode_info(t_hflags.mode_info) {
+		if (!storage) {
+			throw std::invalid_argument("Helix requires a storage to read from.");
+		}
+		initActions(t_hflags);
 	}
 
-	// ==== Helix:Other ====
-	void Helix::clearCaches () {
-		cached_file_size.reset();
-		cached_editable_size.reset();
+	std::unique_ptr<Storage> Helix::createStorage (const std::filesystem::path& filename, AlphaFile::OpenFlags flags, const Flags& t_hflags) {
+		const std::optional<AlphaFile::Absolute> start = t_hflags.mode_info.getStart();
+		const std::optional<AlphaFile::Absolute> end = t_hflags.mode_info.getEnd();
+
+		if (t_hflags.in_place_save == InPlaceSave::Journaled) {
+			// Finish a save that was interrupted before reading anything from the file
+			SaveJournal::recover(filename);
+		}
+
+		const size_t block_size = std::max<size_t>(t_hflags.block_size, 1);
+		size_t max_block_count = t_hflags.max_block_count;
+		if (t_hflags.cache_size.has_value()) {
+			max_block_count = std::max<size_t>(t_hflags.cache_size.value() / block_size, 1);
+		}
+
+		std::unique_ptr<Storage> result;
+		if (t_hflags.read_backend == ReadBackend::MemoryMapped) {
+			result = std::make_unique<MappedStorage>(filename, flags, block_size, max_block_count, start, end);
+		} else if (t_hflags.cache_policy.has_value()) {
+			// The cache in front of it does the caching, so AlphaFile only needs to hold the block being read
+			result = std::make_unique<CachedStorage>(
+				std::make_unique<FileStorage>(filename, flags, block_size, 1, start, end),
+				t_hflags.cache_policy.value(), block_size, block_size * max_block_count
+			);
+		} else {
+			result = std::make_unique<FileStorage>(filename, flags, block_size, max_block_count, start, end);
+		}
+		result->setAccessPattern(t_hflags.access_pattern);
+		result->setReadAhead(t_hflags.read_ahead * block_size);
+		return result;
+	}
+
+	Helix::~Helix () {}
+
+	void Helix::initActions (const Flags& t_hflags) {
+		if (t_hflags.coalesce_interval.has_value()) {
+			actions.setCoalescing(t_hflags.coalesce_actions, t_hflags.coalesce_interval.value());
+		} else {
+			actions.setCoalescing(t_hflags.coalesce_actions);
+		}
+		actions.setEditOnly(!mode_info.supportsInsertion() && !mode_info.supportsDeletion());
+
+		const std::filesystem::path filename = storage->getFilename();
+		if (t_hflags.journal_actions && !filename.empty()) {
+			action_journal = std::make_unique<ActionJournal>(ActionJournal::getJournalPath(filename), t_hflags.journal_sync_interval, getIOQueue());
+		}
 	}
 
+	// ==== Helix:Other ====
 	bool Helix::isWritable () const {
-		return file.isWritable();
+		return storage->isWritable();
 	}
 
 	size_t Helix::getSize () {
-		return actions.getSizeDifference(file.getSize());
+		return actions.getSizeDifference(storage->getSize());
 	}
 	size_t Helix::getEditableSize () {
-		return actions.getSizeDifference(file.getUnderlyingFile().getEditableSize());
+		return actions.getSizeDifference(storage->getEditableSize());
 	}
 
     size_t Helix::getCachedSize () {
-		if (!cached_file_size.has_value()) {
-			cached_file_size = getSize();
-		}
-		return cached_file_size.value();
+		return getSize();
 	}
     size_t Helix::getCachedEditableSize () {
-		if (!cached_editable_size.has_value()) {
-			cached_editable_size = getSize();
-		}
-		return cached_editable_size.value();
+		return getEditableSize();
 	}
 
 	std::optional<std::byte> Helix::read (AlphaFile::Natural position) {
 		std::variant<std::byte, AlphaFile::Natural> data = actions.readFromStorage(position);
 		if (std::holds_alternative<std::byte>(data)) {
+			counters.reads_from_actions.add();
 			return std::get<std::byte>(data);
 		} else {
-			return file.read(std::get<AlphaFile::Natural>(data));
+			counters.reads_from_storage.add();
+			return readStorage(std::get<AlphaFile::Natural>(data));
 		}
 	}
 	std::vector<std::byte> Helix::read (AlphaFile::Natural position, size_t amount) {
-		// This is bleh, it'd be nice to have an optimized method for this that doesn't call the function a ton of times
 		std::vector<std::byte> data;
-		data.reserve(amount);
-		for (size_t i = 0; i < amount; i++) {
-			std::optional<std::byte> byte_opt = read(position + i);
-			if (!byte_opt.has_value()) {
-				break;
+		// Only what there is to read, which is appended piece by piece rather than zeroed first and then overwritten
+		const size_t size = getSize();
+		const size_t readable = position < size ? std::min(amount, static_cast<size_t>(size - position)) : 0;
+		data.reserve(readable);
+
+		const bool read_pieces = actions.readPieces(position, readable, [this, &data, readable] (const Piece& piece) {
+			switch (piece.source) {
+				case Piece::Source::Fill:
+					data.insert(data.end(), piece.length, piece.fill);
+					counters.reads_from_actions.add(piece.length);
+					return true;
+				case Piece::Source::Buffer: {
+					const std::byte* piece_data = actions.getPieceData(piece);
+					data.insert(data.end(), piece_data, piece_data + piece.length);
+					counters.reads_from_actions.add(piece.length);
+					return true;
+				}
+				case Piece::Source::File: {
+					// Storage reads into a buffer, so this is the one part that does have to be sized up front
+					const size_t start = data.size();
+					const size_t length = std::min(piece.length, readable - start);
+					data.resize(start + length);
+					const size_t amount_read = readStorage(piece.offset, data.data() + start, length);
+					data.resize(start + amount_read);
+					counters.reads_from_storage.add(amount_read);
+					return amount_read == piece.length;
+				}
+			}
+			return false;
+		});
+
+		if (!read_pieces) {
+			// There are actions that can only be replayed, so go byte by byte
+			for (size_t index = 0; index < amount; index++) {
+				std::optional<std::byte> byte_opt = read(position + index);
+				if (!byte_opt.has_value()) {
+					break;
+				}
+				data.push_back(byte_opt.value());
 			}
-			data.push_back(byte_opt.value());
 		}
 		return data;
 	}
+	size_t Helix::read (AlphaFile::Natural position, std::byte* output, size_t amount) {
+		size_t written = 0;
+
+		// Resolve the range into runs once, and copy each run as a whole
+		const bool read_pieces = actions.readPieces(position, amount, [this, output, &written] (const Piece& piece) {
+			std::byte* destination = output + written;
+			switch (piece.source) {
+				case Piece::Source::Fill:
+					std::fill(destination, destination + piece.length, piece.fill);
+					written += piece.length;
+					counters.reads_from_actions.add(piece.length);
+					return true;
+				case Piece::Source::Buffer:
+					std::memcpy(destination, actions.getPieceData(piece), piece.length);
+					written += piece.length;
+					counters.reads_from_actions.add(piece.length);
+					return true;
+				case Piece::Source::File: {
+					const size_t amount_read = readStorage(piece.offset, destination, piece.length);
+					written += amount_read;
+					counters.reads_from_storage.add(amount_read);
+					// A short read means we hit the end of the file, and so the end of what can be read.
+					return amount_read == piece.length;
+				}
+			}
+			return false;
+		});
+
+		if (!read_pieces) {
+			// There are actions that can only be replayed, so go byte by byte
+			for (; written < amount; written++) {
+				std::optional<std::byte> byte_opt = read(position + written);
+				if (!byte_opt.has_value()) {
+					break;
+				}
+				output[written] = byte_opt.value();
+			}
+		}
+		return written;
+	}
+
+	void Helix::setAccessPattern (AccessPattern pattern) {
+		storage->setAccessPattern(pattern);
+	}
+
+	bool Helix::isMapped () const {
+		return storage->isMapped();
+	}
+
+	Storage& Helix::getStorage () {
+		return *storage;
+	}
+
+	std::optional<CacheStats> Helix::getCacheStats () const {
+		return storage->getCacheStats();
+	}
+
+	HelixStats Helix::getStats () {
+		HelixStats stats;
+		stats.reads_from_actions = counters.reads_from_actions.get();
+		stats.reads_from_storage = counters.reads_from_storage.get();
+		stats.action_lookups = actions.getReadCounters().lookups.get();
+		stats.records_walked = actions.getReadCounters().records_walked.get();
+		for (size_t phase = 0; phase < save_phase_count; phase++) {
+			stats.bytes_written[phase] = counters.bytes_written[phase].get();
+		}
+		stats.cache = storage->getCacheStats();
+		stats.action_count = actions.getActionCount();
+		stats.action_arena_bytes = actions.getArena().getBytesHeld();
+		stats.action_record_bytes = actions.getRecordMemory();
+		return stats;
+	}
+
+	void Helix::setTracer (std::shared_ptr<Tracer> t_tracer) {
+		tracer = std::move(t_tracer);
+	}
+
+	const std::shared_ptr<Tracer>& Helix::getTracer () const {
+		return tracer;
+	}
+
+	void Helix::resetStats () {
+		counters.reads_from_actions.reset();
+		counters.reads_from_storage.reset();
+		for (StatCounter& counter : counters.bytes_written) {
+			counter.reset();
+		}
+		actions.getReadCounters().lookups.reset();
+		actions.getReadCounters().records_walked.reset();
+		storage->resetCacheStats();
+	}
+
+	std::optional<std::byte> Helix::readStorage (AlphaFile::Natural position) {
+		return storage->read(position);
+	}
+	size_t Helix::readStorage (AlphaFile::Natural position, std::byte* output, size_t amount) {
+		return storage->read(position, output, amount);
+	}
 
 	std::optional<uint8_t> Helix::readU8 (AlphaFile::Natural position) {
 		std::optional<std::byte> value = read(position);
@@ -81,8 +742,8 @@ namespace Helix {
 
 
     std::optional<uint16_t> Helix::readU16BE (AlphaFile::Natural position) {
-		std::vector<std::byte> values = read(position, 2);
-		if (values.size() < 2) {
+		std::array<std::byte, 2> values;
+		if (read(position, values.data(), values.size()) < values.size()) {
 			// Not enough bytes
 			return std::nullopt;
 		}
@@ -90,8 +751,8 @@ namespace Helix {
 			static_cast<uint16_t>(values.at(1));
 	}
 	std::optional<uint16_t> Helix::readU16LE (AlphaFile::Natural position) {
-		std::vector<std::byte> values = read(position, 2);
-		if (values.size() < 2) {
+		std::array<std::byte, 2> values;
+		if (read(position, values.data(), values.size()) < values.size()) {
 			// Not enough bytes
 			return std::nullopt;
 		}
@@ -101,8 +762,8 @@ namespace Helix {
 
 
     std::optional<uint32_t> Helix::readU32BE (AlphaFile::Natural position) {
-		std::vector<std::byte> values = read(position, 4);
-		if (values.size() < 4) {
+		std::array<std::byte, 4> values;
+		if (read(position, values.data(), values.size()) < values.size()) {
 			// Not enough bytes
 			return std::nullopt;
 		}
@@ -112,8 +773,8 @@ namespace Helix {
 			static_cast<uint32_t>(values.at(3));
 	}
 	std::optional<uint32_t> Helix::readU32LE (AlphaFile::Natural position) {
-		std::vector<std::byte> values = read(position, 4);
-		if (values.size() < 4) {
+		std::array<std::byte, 4> values;
+		if (read(position, values.data(), values.size()) < values.size()) {
 			// Not enough bytes
 			return std::nullopt;
 		}
@@ -125,8 +786,8 @@ namespace Helix {
 
 
     std::optional<uint64_t> Helix::readU64BE (AlphaFile::Natural position) {
-		std::vector<std::byte> values = read(position, 8);
-		if (values.size() < 8) {
+		std::array<std::byte, 8> values;
+		if (read(position, values.data(), values.size()) < values.size()) {
 			// Not enough bytes
 			return std::nullopt;
 		}
@@ -140,8 +801,8 @@ namespace Helix {
 			static_cast<uint64_t>(values.at(7));
 	}
 	 std::optional<uint64_t> Helix::readU64LE (AlphaFile::Natural position) {
-		std::vector<std::byte> values = read(position, 8);
-		if (values.size() < 8) {
+		std::array<std::byte, 8> values;
+		if (read(position, values.data(), values.size()) < values.size()) {
 			// Not enough bytes
 			return std::nullopt;
 		}
@@ -215,10 +876,12 @@ namespace Helix {
 
 	// TODO: should editing clear caches?
 	void Helix::edit (AlphaFile::Natural position, std::byte value) {
-		actions.addAction(std::make_unique<EditAction>(position, std::vector<std::byte>{value}));
+		actions.addEdit(position, std::vector<std::byte>{value});
+		journalActions();
 	}
 	void Helix::edit (AlphaFile::Natural position, std::vector<std::byte>&& values) {
-		actions.addAction(std::make_unique<EditAction>(position, std::forward<std::vector<std::byte>>(values)));
+		actions.addEdit(position, std::forward<std::vector<std::byte>>(values));
+		journalActions();
 	}
 
 	void Helix::insert (AlphaFile::Natural position, size_t amount, std::byte pattern) {
@@ -226,12 +889,10 @@ namespace Helix {
 			throw std::runtime_error("Insertion is unsupported in this mode.");
 		}
 
-		clearCaches();
-
 		// We don't bother filling it with the insertion_value since it essentially already does that
 		if (pattern == InsertionAction::insertion_value) {
 			// TODO: since we don't bother filling.. the parameter should just be an optional.
-			actions.addAction(std::make_unique<InsertionAction>(position, amount));
+			actions.addInsertion(position, amount);
 		} else {
 			std::vector<std::byte> data;
 			data.resize(amount);
@@ -239,10 +900,11 @@ namespace Helix {
 
 			std::vector<std::unique_ptr<BaseAction>> bundled_list;
 			bundled_list.push_back(std::unique_ptr<BaseAction>(new InsertionAction(position, amount)));
-			bundled_list.push_back(std::unique_ptr<BaseAction>(new EditAction(position, std::move(data))));
+			bundled_list.push_back(std::unique_ptr<BaseAction>(new EditAction(position, std::move(data), &actions.getArena())));
 
 			actions.addAction(std::unique_ptr<BaseAction>(new BundledAction(std::move(bundled_list))));
 		}
+		journalActions();
 	}
 
 	void Helix::insert (AlphaFile::Natural position, size_t amount, const std::vector<std::byte>& pattern) {
@@ -250,8 +912,6 @@ namespace Helix {
 			throw std::runtime_error("Insertion is unsupported in this mode.");
 		}
 
-		clearCaches();
-
 		std::vector<std::byte> data;
 		data.reserve(amount);
 
@@ -261,9 +921,10 @@ namespace Helix {
 
 		std::vector<std::unique_ptr<BaseAction>> bundled_actions;
 		bundled_actions.push_back(std::unique_ptr<BaseAction>(new InsertionAction(position, amount)));
-		bundled_actions.push_back(std::unique_ptr<BaseAction>(new EditAction(position, std::move(data))));
+		bundled_actions.push_back(std::unique_ptr<BaseAction>(new EditAction(position, std::move(data), &actions.getArena())));
 
 		actions.addAction(std::make_unique<BundledAction>(std::move(bundled_actions)));
+		journalActions();
 	}
 
 	void Helix::deletion (AlphaFile::Natural position, size_t amount) {
@@ -271,32 +932,74 @@ namespace Helix {
 			throw std::runtime_error("Deletion is unsupported in this mode.");
 		}
 
-		clearCaches();
+		actions.addDeletion(position, amount);
+		journalActions();
+	}
 
-		actions.addAction(std::make_unique<DeletionAction>(position, amount));
+	void Helix::checkBatch (const EditBatch& batch) const {
+		if (batch.hasInsertions() && !mode_info.supportsInsertion()) {
+			throw std::runtime_error("Insertion is unsupported in this mode.");
+		}
+		if (batch.hasDeletions() && !mode_info.supportsDeletion()) {
+			throw std::runtime_error("Deletion is unsupported in this mode.");
+		}
+	}
+
+	void Helix::commitBatch (EditBatch&& batch) {
+		checkBatch(batch);
+
+		std::vector<std::unique_ptr<BaseAction>> batch_actions = batch.build(&actions.getArena());
+		if (batch_actions.empty()) {
+			return;
+		}
+
+		actions.breakCoalescing();
+		if (batch_actions.size() == 1) {
+			actions.addAction(std::move(batch_actions.front()));
+		} else {
+			actions.addAction(std::make_unique<BundledAction>(std::move(batch_actions)));
+		}
+		journalActions();
 	}
 
 	// TODO: investigate if this makes sense
-	SaveStatus Helix::save () {
-		clearCaches();
+	SaveStatus Helix::save (const SaveControl& control) {
+		TraceSpan span(tracer.get(), "save", "save");
+		waitBackgroundSave();
+		// Storage that isn't backed by a file (such as MemoryStorage) has nothing to save over, only saveAs works
+		if (storage->getFilename().empty()) {
+			return SaveStatus::InvalidMode;
+		}
 		// TODO: check if it's writable
 		SaveAsMode save_as_mode = mode_info.getSaveAsMode();
+		SaveStatus status;
 		if (save_as_mode == SaveAsMode::Whole) {
-			return saveAsFile(file.getFilename());
+			const std::optional<SaveStatus> in_place_status = save_writeInPlace(control);
+			status = in_place_status.has_value() ? in_place_status.value() : saveAsFile(storage->getFilename(), control);
 		} else if (save_as_mode == SaveAsMode::Partial) {
-			return save_file_simple();
+			status = save_file_simple(control);
 		} else {
 			return SaveStatus::InvalidMode;
 		}
+
+		if (status == SaveStatus::Success) {
+			journalSaved();
+		}
+		return status;
 	}
 
-	SaveStatus Helix::saveAs (const std::filesystem::path& destination) {
+	SaveStatus Helix::saveAs (const std::filesystem::path& destination, const SaveControl& control) {
 		// TODO: check that this sets the active file to the newly saved-as file
-		clearCaches();
+		TraceSpan span(tracer.get(), "saveAs", "save");
+		waitBackgroundSave();
 		// TODO: check if it's writable.
 		SaveAsMode save_as_mode = mode_info.getSaveAsMode();
 		if (save_as_mode == SaveAsMode::Whole) {
-			return saveAsFile(destination);
+			const SaveStatus status = saveAsFile(destination, control);
+			if (status == SaveStatus::Success) {
+				journalSaved();
+			}
+			return status;
 		} else if (save_as_mode == SaveAsMode::Partial) {
 			return SaveStatus::Success; // TODO: partial saving. This would presumably not be able to do saveas? Check the sources of Partial-mode
 		} else {
@@ -304,24 +1007,259 @@ namespace Helix {
 		}
 	}
 
+	// ==== Helix:Async ====
+	std::future<SaveStatus> Helix::saveAsync (SaveControl control) {
+		return getIOQueue().submit([this, control = std::move(control)] () {
+			return save(control);
+		});
+	}
+
+	std::future<SaveStatus> Helix::saveAsAsync (const std::filesystem::path& destination, SaveControl control) {
+		return getIOQueue().submit([this, destination, control = std::move(control)] () {
+			return saveAs(destination, control);
+		});
+	}
+
+	std::optional<CopyStrategy> Helix::getLastCopyStrategy () const {
+		return last_copy_strategy;
+	}
+
+	bool Helix::hasPendingAsync () {
+		return io_queue && io_queue->getPendingCount() != 0;
+	}
+
+	// ==== Helix:Journal ====
+	size_t Helix::recoverActions () {
+		if (!action_journal) {
+			return 0;
+		}
+
+		std::optional<std::vector<std::unique_ptr<BaseAction>>> recovered = ActionJournal::read(ActionJournal::getJournalPath(storage->getFilename()), storage->getSize(), &actions.getArena());
+		if (!recovered.has_value()) {
+			return 0;
+		}
+
+		const size_t count = recovered.value().size();
+		actions.breakCoalescing();
+		for (std::unique_ptr<BaseAction>& action : recovered.value()) {
+			actions.addAction(std::move(action));
+		}
+		journalActions();
+		return count;
+	}
+
+	void Helix::flushJournal () {
+		if (action_journal) {
+			action_journal->sync(actions, storage->getSize());
+			action_journal->flush();
+		}
+	}
+
+	void Helix::discardJournal () {
+		if (action_journal) {
+			action_journal->discard();
+		}
+	}
+
+	void Helix::journalActions () {
+		if (action_journal) {
+			action_journal->sync(actions, storage->getSize());
+		}
+	}
+
+	void Helix::journalSaved () {
+		if (action_journal && actions.getActionCount() == 0) {
+			// What is on the disk now is what the journal is relative to when it is next opened
+			const std::filesystem::path filename = storage->getFilename();
+			std::error_code error;
+			const uintmax_t size = std::filesystem::file_size(filename, error);
+			action_journal->restart(error ? storage->getSize() : static_cast<size_t>(size));
+		}
+	}
+
+	// ==== Helix:Session ====
+	bool Helix::saveSession (const std::filesystem::path& path) {
+		return SessionFile::write(path, actions, SessionFile::getBase(*storage));
+	}
+
+	bool Helix::loadSession (const std::filesystem::path& path) {
+		if (isSavingInBackground()) {
+			return false;
+		}
+
+		const std::optional<std::vector<std::byte>> contents = SessionFile::read(path);
+		const SessionFile::Base base = SessionFile::getBase(*storage);
+		if (!contents.has_value() || !SessionFile::isValid(contents.value().data(), contents.value().size(), base)) {
+			return false;
+		}
+
+		// Decoded into an arena of its own, so that a session that can't be decoded leaves the actions as they were
+		auto loaded_arena = std::make_unique<ActionArena>();
+		std::optional<std::vector<std::unique_ptr<BaseAction>>> loaded = SessionFile::decode(contents.value().data(), contents.value().size(), base, loaded_arena.get());
+		if (!loaded.has_value()) {
+			return false;
+		}
+
+		actions.replace(std::move(loaded.value()), std::move(loaded_arena));
+		journalActions();
+		return true;
+	}
+
+	// ==== Helix:Background-Save ====
+	SaveStatus Helix::saveInBackground (SaveControl control) {
+		return saveAsInBackground(storage->getFilename(), std::move(control));
+	}
+
+	SaveStatus Helix::saveAsInBackground (const std::filesystem::path& initial_destination, SaveControl control) {
+		waitBackgroundSave();
+
+		const std::filesystem::path source_path = storage->getFilename();
+		const bool is_whole_view = !mode_info.getStart().has_value() && !mode_info.getEnd().has_value();
+		// Once an earlier background save replaced the file, file pieces are offsets into the old file that the storage
+		// still has open, not into the one at source_path, so only the storage can read them
+		if (mode_info.getSaveAsMode() != SaveAsMode::Whole || !is_whole_view || source_path.empty() || storage_replaced) {
+			return saveAs(initial_destination, control);
+		}
+
+		auto snapshot = std::make_shared<SaveSnapshot>();
+		const bool read_pieces = actions.readPieces(0, PieceTable::unbounded_length, [this, &snapshot] (const Piece& piece) {
+			Piece copy = piece;
+			if (piece.source == Piece::Source::Buffer) {
+				const std::byte* data = actions.getPieceData(piece);
+				copy.offset = snapshot->buffer.size();
+				snapshot->buffer.insert(snapshot->buffer.end(), data, data + piece.length);
+			}
+			snapshot->pieces.push_back(copy);
+			return true;
+		});
+		if (!read_pieces) {
+			// The view can only be found by replaying actions, which can't be done off of this thread
+			return saveAs(initial_destination, control);
+		}
+		snapshot->size = getSize();
+
+		std::filesystem::path destination;
+		std::filesystem::path temp_file_path;
+		const SaveStatus prepare_status = save_prepareDestination(initial_destination, destination, temp_file_path);
+		if (prepare_status != SaveStatus::Success) {
+			return prepare_status;
+		}
+
+		// Later edits have to be new actions, not merged into the ones being saved
+		actions.breakCoalescing();
+		background_save_action_count = actions.getActionCount();
+		background_save_serial = actions.getLastSerial();
+		background_save_replaces_file = std::filesystem::exists(destination) && std::filesystem::equivalent(destination, source_path);
+
+		background_save = getIOQueue().submit([snapshot, source_path, temp_file_path, destination, control = std::move(control), &save_counters = counters, save_tracer = tracer] () {
+			return save_writeSnapshot(*snapshot, source_path, temp_file_path, destination, control, save_counters, save_tracer.get());
+		});
+		return SaveStatus::Success;
+	}
+
+	std::optional<SaveStatus> Helix::pollBackgroundSave () {
+		if (!isSavingInBackground() || background_save.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return std::nullopt;
+		}
+		return save_finishBackground();
+	}
+
+	SaveStatus Helix::waitBackgroundSave () {
+		if (!isSavingInBackground()) {
+			return SaveStatus::Success;
+		}
+		return save_finishBackground();
+	}
+
+	bool Helix::isSavingInBackground () const {
+		return background_save.valid();
+	}
+
+	IOQueue& Helix::getIOQueue () {
+		if (!io_queue) {
+			io_queue = std::make_unique<IOQueue>();
+		}
+		return *io_queue;
+	}
+
 	// ==== Helix:Save-Internal ====
-	SaveStatus Helix::save_file_simple () {
-		actions.save(file.getUnderlyingFile().getBasicFile());
+	SaveStatus Helix::save_file_simple (const SaveControl& control) {
+		AlphaFile::BasicFile* basic_file = storage->getBasicFile();
+		if (basic_file == nullptr) {
+			return SaveStatus::InvalidMode;
+		}
+		TraceSpan span(tracer.get(), "replay", "save");
+		// Writes go straight into the file, so stopping part of the way through would leave it half saved
+		actions.save(*basic_file, save_getOptions(storage->getSize()), [&control] (size_t done, size_t total) {
+			control.report(SavePhase::Replay, done, total);
+			return true;
+		});
+		actions.clear();
+		// The file was written to directly, so anything cached from it is out of date
+		storage->invalidate();
 		return SaveStatus::Success;
 	}
 
-	SaveStatus Helix::saveAsFile (const std::filesystem::path& initial_destination) {
-		struct FileSizeInfo {
-			const size_t previous;
-			const size_t result;
+	std::optional<SaveStatus> Helix::save_writeInPlace (const SaveControl& control) {
+		const bool is_whole_view = !mode_info.getStart().has_value() && !mode_info.getEnd().has_value();
+		const std::filesystem::path filename = storage->getFilename();
+		if (in_place_save == InPlaceSave::Off || !is_whole_view || filename.empty() || !storage->isWritable() || storage_replaced) {
+			return std::nullopt;
+		}
 
-			size_t largest () const {
-				return std::max(previous, result);
+		EditIndex edits;
+		if (!actions.collectEdits(edits)) {
+			return std::nullopt;
+		}
+
+		// Only the edited ranges are written, which must all be inside of the file for its size to stay the same
+		const size_t file_size = storage->getSize();
+		std::vector<FilePatch> patches;
+		bool inside = true;
+		AlphaFile::Natural position = 0;
+		edits.forEachPiece(0, PieceTable::unbounded_length, [&] (const Piece& piece) {
+			if (piece.source == Piece::Source::Buffer) {
+				inside = inside && position + piece.length <= file_size;
+				patches.push_back(FilePatch{static_cast<AlphaFile::Absolute>(position), edits.getBufferData(piece), piece.length});
 			}
-		};
+			position += piece.length;
+			return true;
+		});
+		if (!inside) {
+			return std::nullopt;
+		}
+
+		if (control.isCancelled()) {
+			return SaveStatus::Cancelled;
+		}
+
+		TraceSpan span(tracer.get(), "inPlace", "save");
+		span.addArg("patches", patches.size());
+		control.report(SavePhase::Replay, 0, patches.size());
+		const SaveJournal::WriteResult result = SaveJournal::write(filename, patches, in_place_save == InPlaceSave::Journaled);
+		if (result == SaveJournal::WriteResult::Unchanged) {
+			return SaveStatus::InsufficientPermissions;
+		} else if (result == SaveJournal::WriteResult::Partial) {
+			// Some of the patches may have made it into the file. The actions are kept and only ever overwrite those
+			// bytes, so reading through them still gives the edited file once the cache stops serving the old bytes.
+			storage->invalidate();
+			return SaveStatus::PartiallyWritten;
+		}
+		control.report(SavePhase::Replay, patches.size(), patches.size());
+		for (const FilePatch& patch : patches) {
+			counters.bytes_written[static_cast<size_t>(SavePhase::Replay)].add(patch.length);
+		}
+
+		actions.clear();
+		// The file was written to directly, so anything cached from it is out of date
+		storage->invalidate();
+		return SaveStatus::Success;
+	}
 
+	SaveStatus Helix::save_prepareDestination (const std::filesystem::path& initial_destination, std::filesystem::path& destination, std::filesystem::path& temp_file_path) {
+		TraceSpan validate_span(tracer.get(), "validate", "save");
 		// Make the path more 'normal'
-		std::filesystem::path destination = initial_destination.lexically_normal();
+		destination = initial_destination.lexically_normal();
 
 		if (destination == "" || !save_hasValidFilename(destination)) {
 			return SaveStatus::InvalidFilename;
@@ -330,7 +1268,7 @@ namespace Helix {
 		// Make sure there is a parent folder
 		// Not sure if we can actually get a blank parent_path
 		if (destination.parent_path() == "") {
-			destination = file.getFilename().parent_path() / destination;
+			destination = storage->getFilename().parent_path() / destination;
 		}
 
 		// Make sure that the folder it's in exists.
@@ -339,44 +1277,317 @@ namespace Helix {
 			return SaveStatus::InvalidDestination;
 		}
 
-
-		const size_t previous_file_size = file.getSize();
-		FileSizeInfo file_size{previous_file_size, save_calculateResultingFileSize(previous_file_size)};
+		validate_span.end();
 
 		// TODO: provide an option to store the temp file in the OS temp folder using filesystem::temp_directory_path
+		TraceSpan temp_path_span(tracer.get(), "tempPath", "save");
 		const std::optional<std::pair<std::filesystem::path, std::filesystem::path>> paths = save_generateTempPath(destination);
 		if (!paths.has_value()) {
 			return SaveStatus::TempFileIterationLimit;
 		}
 
-		const auto& [temp_filename, temp_file_path] = paths.value();
+		temp_file_path = paths.value().second;
+		return SaveStatus::Success;
+	}
+
+	SaveStatus Helix::saveAsFile (const std::filesystem::path& initial_destination, const SaveControl& control) {
+		TraceSpan span(tracer.get(), "saveAsFile", "save");
+		std::filesystem::path destination;
+		std::filesystem::path temp_file_path;
+		const SaveStatus prepare_status = save_prepareDestination(initial_destination, destination, temp_file_path);
+		if (prepare_status != SaveStatus::Success) {
+			return prepare_status;
+		}
+
+		// Streaming writes out the edited view, which is only the entire file if the view isn't constrained
+		const bool is_whole_view = !mode_info.getStart().has_value() && !mode_info.getEnd().has_value();
+
+		SaveStatus status;
+		if ((save_strategy == SaveStrategy::Stream || storage_replaced) && is_whole_view) {
+			status = save_writeStreamed(temp_file_path, control);
+		} else {
+			status = save_writeReplayed(temp_file_path, control);
+		}
+
+		if (status != SaveStatus::Success) {
+			return status;
+		}
+
+		// Rename it to the destination.
+		TraceSpan rename_span(tracer.get(), "rename", "save");
+		control.report(SavePhase::Rename, 0, 1);
+		std::error_code error;
+		const std::filesystem::path source_path = storage->getFilename();
+		std::error_code equivalent_error;
+		const bool replaces_source = !source_path.empty() && std::filesystem::equivalent(destination, source_path, equivalent_error);
+		std::filesystem::rename(temp_file_path, destination, error);
+		if (error) {
+			std::filesystem::remove(temp_file_path, error);
+			return SaveStatus::InsufficientPermissions;
+		}
+		control.report(SavePhase::Rename, 1, 1);
+
+		// Only once the file is in place, as the actions are all that's left of the edits until then
+		actions.clear();
+		if (replaces_source) {
+			// The storage still reads the file that was replaced, which the cleared actions were on top of
+			storage->invalidate();
+			storage_replaced = false;
+		}
+
+		return SaveStatus::Success;
+	}
+	SaveStatus Helix::save_writeStreamed (const std::filesystem::path& temp_file_path, const SaveControl& control) {
+		TraceSpan span(tracer.get(), "write", "save");
+		std::ofstream temp_file(temp_file_path, std::ios::binary | std::ios::trunc);
+		if (!temp_file.is_open()) {
+			return SaveStatus::InsufficientPermissions;
+		}
+
+		std::vector<std::byte> buffer;
+		buffer.resize(save_stream_chunk_size);
+
+		const size_t total = getSize();
+		AlphaFile::Natural position = 0;
+		while (true) {
+			if (control.isCancelled()) {
+				temp_file.close();
+				std::filesystem::remove(temp_file_path);
+				return SaveStatus::Cancelled;
+			}
+
+			const size_t amount = read(position, buffer.data(), buffer.size());
+			temp_file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(amount));
+			if (temp_file.fail()) {
+				break;
+			}
+			counters.bytes_written[static_cast<size_t>(SavePhase::Write)].add(amount);
+			position += amount;
+			control.report(SavePhase::Write, static_cast<size_t>(position), std::max(static_cast<size_t>(position), total));
+
+			// A short read is the end of the edited file
+			if (amount < buffer.size()) {
+				break;
+			}
+		}
+
+		// Close the file before we rename it, so that anything still buffered is written and checked as well.
+		// Running out of space (or an I/O error) leaves a truncated temp file, which must not replace the destination.
+		temp_file.flush();
+		temp_file.close();
+		if (temp_file.fail()) {
+			std::error_code error;
+			std::filesystem::remove(temp_file_path, error);
+			return SaveStatus::InsufficientPermissions;
+		}
+
+		return SaveStatus::Success;
+	}
+	SaveStatus Helix::save_writeReplayed (const std::filesystem::path& temp_file_path, const SaveControl& control) {
+		struct FileSizeInfo {
+			const size_t previous;
+			const size_t result;
+
+			size_t largest () const {
+				return std::max(previous, result);
+			}
+		};
+
+		// Replaying needs a file to copy, storage that isn't backed by one can only be streamed out
+		const std::filesystem::path source_path = storage->getFilename();
+		if (source_path.empty()) {
+			return SaveStatus::InvalidMode;
+		}
+
+		const size_t previous_file_size = storage->getSize();
+		FileSizeInfo file_size{previous_file_size, save_calculateResultingFileSize(previous_file_size)};
 
 		// We simply copy the file as the temp file that we're modifying.
-		std::filesystem::copy_file(file.getFilename(), temp_file_path);
+		std::error_code error;
+		const uintmax_t source_size = std::filesystem::file_size(source_path, error);
+		const SaveStatus copy_status = save_copyFile(source_path, temp_file_path, error ? previous_file_size : static_cast<size_t>(source_size), control);
+		if (copy_status != SaveStatus::Success) {
+			return copy_status;
+		}
 
 		// TODO: this may not be needed?
 		// Resize to the size of the largest file (src, src-after-modifications)
 		// we'll cut off any remaining bytes.
-		std::filesystem::resize_file(temp_file_path, file_size.largest());
+		TraceSpan resize_span(tracer.get(), "resize", "save");
+		std::filesystem::resize_file(temp_file_path, file_size.largest(), error);
+		if (error) {
+			std::filesystem::remove(temp_file_path, error);
+			return SaveStatus::InsufficientPermissions;
+		}
+		resize_span.end();
 
+		TraceSpan replay_span(tracer.get(), "replay", "save");
+		replay_span.addArg("actions", actions.getActionCount());
 		AlphaFile::BasicFile temp_file;
 		// TODO: handle errors
 		temp_file.open(AlphaFile::OpenFlags(true), temp_file_path);
 
 		// Write all the actions to the newly created temporary file
-		actions.save(temp_file);
+		const bool replayed = actions.save(temp_file, save_getOptions(file_size.largest()), [&control] (size_t done, size_t total) {
+			control.report(SavePhase::Replay, done, total);
+			return !control.isCancelled();
+		});
+		if (!replayed) {
+			temp_file.close();
+			std::filesystem::remove(temp_file_path);
+			return SaveStatus::Cancelled;
+		}
+
+		replay_span.end();
 
 		// Resize the file to the appropriate size after all the insertions/deletions.
+		TraceSpan final_resize_span(tracer.get(), "finalResize", "save");
+		control.report(SavePhase::Resize, 0, 1);
 		temp_file.resize(file_size.result);
+		control.report(SavePhase::Resize, 1, 1);
 
 		// Close the file before we rename it, just in case.
 		temp_file.close();
 
+		return SaveStatus::Success;
+	}
+	SaveStatus Helix::save_copyFile (const std::filesystem::path& source_path, const std::filesystem::path& temp_file_path, size_t size, const SaveControl& control) {
+		TraceSpan span(tracer.get(), "copy", "save");
+		size_t copied_total = 0;
+		std::optional<CopyStrategy> strategy;
+		bool failed = false;
+		try {
+			strategy = copyFile(source_path, temp_file_path, save_copy_chunk_size, [&control, &copied_total, size] (size_t copied) {
+				copied_total = copied;
+				control.report(SavePhase::Copy, copied, std::max(copied, size));
+				return !control.isCancelled();
+			});
+		} catch (const std::runtime_error&) {
+			failed = true;
+		}
+		counters.bytes_written[static_cast<size_t>(SavePhase::Copy)].add(copied_total);
+		if (failed || !strategy.has_value()) {
+			// Whatever was copied before stopping is of no use
+			std::error_code error;
+			std::filesystem::remove(temp_file_path, error);
+			return failed ? SaveStatus::InsufficientPermissions : SaveStatus::Cancelled;
+		}
+		last_copy_strategy = strategy;
+		span.addArg("strategy", strategy.value() == CopyStrategy::Reflink ? "reflink" : strategy.value() == CopyStrategy::CopyFileRange ? "copy_file_range" : "buffered");
+		return SaveStatus::Success;
+	}
+	SaveStatus Helix::save_writeSnapshot (const SaveSnapshot& snapshot, const std::filesystem::path& source_path, const std::filesystem::path& temp_file_path, const std::filesystem::path& destination, const SaveControl& control, StatCounters& counters, Tracer* save_tracer) {
+		TraceSpan span(save_tracer, "backgroundSave", "save");
+		TraceSpan write_span(save_tracer, "write", "save");
+		// Read with a handle of our own, as the storage is still being used by the editing thread
+		std::ifstream source(source_path, std::ios::binary);
+		std::ofstream temp_file(temp_file_path, std::ios::binary | std::ios::trunc);
+		// Leaves the destination as it was
+		const auto abandon = [&temp_file, &temp_file_path] (SaveStatus status) {
+			temp_file.close();
+			std::error_code error;
+			std::filesystem::remove(temp_file_path, error);
+			return status;
+		};
+		if (!source.is_open() || !temp_file.is_open()) {
+			return abandon(SaveStatus::InsufficientPermissions);
+		}
+
+		std::vector<char> buffer;
+		buffer.resize(save_stream_chunk_size);
+
+		size_t written = 0;
+		bool reached_end = false;
+		for (const Piece& piece : snapshot.pieces) {
+			size_t remaining = piece.length;
+			size_t offset = piece.offset;
+			while (remaining != 0 && !reached_end) {
+				if (control.isCancelled()) {
+					return abandon(SaveStatus::Cancelled);
+				}
+
+				const size_t amount = std::min(remaining, buffer.size());
+				size_t amount_read = amount;
+				switch (piece.source) {
+					case Piece::Source::Fill:
+						std::fill(buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(amount), static_cast<char>(piece.fill));
+						break;
+					case Piece::Source::Buffer:
+						std::memcpy(buffer.data(), snapshot.buffer.data() + offset, amount);
+						break;
+					case Piece::Source::File:
+						source.seekg(static_cast<std::streamoff>(offset));
+						source.read(buffer.data(), static_cast<std::streamsize>(amount));
+						amount_read = static_cast<size_t>(source.gcount());
+						// A short read at the end of the file is the end of the edited file, same as when reading it.
+						// Anything else is a read error, which would otherwise save a truncated file.
+						if (amount_read < amount) {
+							if (source.bad() || !source.eof()) {
+								return abandon(SaveStatus::InsufficientPermissions);
+							}
+							reached_end = true;
+							source.clear();
+						}
+						break;
+				}
+
+				temp_file.write(buffer.data(), static_cast<std::streamsize>(amount_read));
+				if (temp_file.fail()) {
+					return abandon(SaveStatus::InsufficientPermissions);
+				}
+				counters.bytes_written[static_cast<size_t>(SavePhase::Write)].add(amount_read);
+				written += amount_read;
+				remaining -= amount;
+				offset += amount;
+
+				control.report(SavePhase::Write, written, std::max(written, snapshot.size));
+			}
+
+			if (reached_end) {
+				break;
+			}
+		}
+
+		// Anything still buffered is written (and checked) as it is closed
+		temp_file.flush();
+		temp_file.close();
+		source.close();
+		if (temp_file.fail()) {
+			return abandon(SaveStatus::InsufficientPermissions);
+		}
+		write_span.end();
+
 		// Rename it to the destination.
-		std::filesystem::rename(temp_file_path, destination);
+		TraceSpan rename_span(save_tracer, "rename", "save");
+		control.report(SavePhase::Rename, 0, 1);
+		std::error_code error;
+		std::filesystem::rename(temp_file_path, destination, error);
+		if (error) {
+			return abandon(SaveStatus::InsufficientPermissions);
+		}
+		control.report(SavePhase::Rename, 1, 1);
 
 		return SaveStatus::Success;
 	}
+	SaveStatus Helix::save_finishBackground () {
+		const SaveStatus status = background_save.get();
+		if (status != SaveStatus::Success || !background_save_replaces_file) {
+			return status;
+		}
+
+		const bool unchanged = actions.getActionCount() == background_save_action_count &&
+			actions.getLastSerial() == background_save_serial;
+		if (unchanged) {
+			// Same as a synchronous save: everything that was done is in the file now
+			actions.clear();
+			storage->invalidate();
+			journalSaved();
+		} else {
+			// The newer actions still apply on top of the contents the storage reads, so they're kept as they are
+			storage_replaced = true;
+		}
+		return status;
+	}
 	bool Helix::save_hasValidFilename (const std::filesystem::path& file_path) {
 		// Check if it has a filename that is remotely valid
 		const std::filesystem::path filename = file_path.filename();
@@ -385,6 +1596,26 @@ namespace Helix {
 	size_t Helix::save_calculateResultingFileSize (size_t previous_file_size) {
 		return actions.getSizeDifference(previous_file_size);
 	}
+	size_t Helix::save_calculateChunkSize (size_t file_size) {
+		if (save_chunk_size.has_value()) {
+			return std::max<size_t>(save_chunk_size.value(), 1);
+		}
+
+		// Shifting a file takes about (file_size / chunk_size) reads and writes, so bigger files get bigger chunks.
+		// This is capped so it doesn't take a large part of what memory is left.
+		size_t maximum = save_max_chunk_size;
+		if (std::optional<size_t> available = util::getAvailableMemory()) {
+			maximum = std::min(maximum, available.value() / 16);
+		}
+		maximum = std::max(maximum, save_min_chunk_size);
+
+		return std::clamp(file_size / 64, save_min_chunk_size, maximum);
+	}
+	SaveOptions Helix::save_getOptions (size_t file_size) {
+		SaveOptions options;
+		options.chunk_size = save_calculateChunkSize(file_size);
+		return options;
+	}
 	/// generates filenames in the form: [filename].[4 byte hex].tmp
 	std::filesystem::path Helix::save_generateTempFilename (std::filesystem::path filename) {
 		std::random_device rd;
@@ -434,7 +1665,18 @@ namespace Helix {
 			return data;
 		}
 
-		Events::Events (sol::table t_keys) : keys(t_keys) {}
+		std::string describeFunction (const sol::function& func) {
+			lua_State* state = func.lua_state();
+			func.push();
+			lua_Debug info;
+			// '>' takes the function off of the stack
+			if (lua_getinfo(state, ">S", &info) == 0) {
+				return "?";
+			}
+			return std::string(info.short_src) + ":" + std::to_string(info.linedefined);
+		}
+
+		Events::Events (sol::table t_keys, const std::shared_ptr<Tracer>& t_tracer) : keys(t_keys), tracer(&t_tracer) {}
 
 		sol::table Events::getKeys () {
 			return keys;
@@ -447,23 +1689,31 @@ namespace Helix {
 		}
 
 		void Events::triggerLua (int32_t key, sol::variadic_args va)  {
-			if (std::vector<sol::function>* event_listeners = util::mapFindEntry(listeners, key)) {
-				for (sol::function& func : *event_listeners) {
-					func(sol::as_args(va));
-				}
+			callListeners(key, [&va] (sol::function& func) {
+				func(sol::as_args(va));
+			});
+		}
+
+		std::string_view Events::getName (int32_t key) const {
+			auto iterator = names.find(key);
+			if (iterator == names.end()) {
+				return "event";
 			}
+			return iterator->second;
 		}
 
 		int32_t Events::createEventType (std::string name) {
 			const int32_t id = current_id++;
 			keys[name] = id;
+			names[id] = name;
 			return id;
 		}
 	} // namespace LuaUtil
 
 	// ==== PluginHelix:CurrentFile ====
-	PluginHelix::CurrentFile::CurrentFile (PluginHelix& t_helix) : helix(t_helix), events(helix.getLua().create_table()) {
+	PluginHelix::CurrentFile::CurrentFile (PluginHelix& t_helix) : helix(t_helix), events(helix.getLua().create_table(), helix.getTracer()) {
 		events.createEventType("Edit");
+		events.createEventType("Batch");
 	}
 
 	LuaUtil::Events& PluginHelix::CurrentFile::getEvents () {
@@ -498,6 +1748,40 @@ namespace Helix {
 		return helix.saveAs(filename);
 	}
 
+	sol::table PluginHelix::CurrentFile::getStats () {
+		const HelixStats stats = helix.getStats();
+		sol::state& lua = helix.getLua();
+
+		sol::table result = lua.create_table();
+		result["readsFromActions"] = stats.reads_from_actions;
+		result["readsFromStorage"] = stats.reads_from_storage;
+		result["actionLookups"] = stats.action_lookups;
+		result["recordsWalked"] = stats.records_walked;
+		result["averageRecordsWalked"] = stats.getAverageRecordsWalked();
+
+		sol::table bytes_written = lua.create_table();
+		bytes_written["Copy"] = stats.getBytesWritten(SavePhase::Copy);
+		bytes_written["Write"] = stats.getBytesWritten(SavePhase::Write);
+		bytes_written["Replay"] = stats.getBytesWritten(SavePhase::Replay);
+		bytes_written["Resize"] = stats.getBytesWritten(SavePhase::Resize);
+		bytes_written["Rename"] = stats.getBytesWritten(SavePhase::Rename);
+		result["bytesWritten"] = bytes_written;
+
+		if (stats.cache.has_value()) {
+			sol::table cache = lua.create_table();
+			cache["hits"] = stats.cache->hits;
+			cache["misses"] = stats.cache->misses;
+			cache["evictions"] = stats.cache->evictions;
+			cache["prefetches"] = stats.cache->prefetches;
+			result["cache"] = cache;
+		}
+
+		result["actionCount"] = stats.action_count;
+		result["actionArenaBytes"] = stats.action_arena_bytes;
+		result["actionRecordBytes"] = stats.action_record_bytes;
+		return result;
+	}
+
 	// ==== PluginHelix:Constructors ====
 	PluginHelix::PluginHelix (MlActions::ActionList& action_list, std::filesystem::path t_filename, AlphaFile::OpenFlags t_flags, Flags t_hflags) :
         Helix(action_list, t_filename, t_flags, t_hflags), current_file(*this) {
@@ -528,7 +1812,9 @@ namespace Helix {
 			"InvalidDestination", SaveStatus::InvalidDestination,
 			"InsufficientPermissions", SaveStatus::InsufficientPermissions,
 			"TempFileIterationLimit", SaveStatus::TempFileIterationLimit,
-			"InvalidMode", SaveStatus::InvalidMode
+			"InvalidMode", SaveStatus::InvalidMode,
+			"Cancelled", SaveStatus::Cancelled,
+			"PartiallyWritten", SaveStatus::PartiallyWritten
 		);
 
 		lua.new_enum(
@@ -557,6 +1843,7 @@ namespace Helix {
 			"deletion", &CurrentFile::deletion,
 			"save", &CurrentFile::save,
 			"saveAs", &CurrentFile::saveAs,
+			"getStats", &CurrentFile::getStats,
 			// This is a bit icky
 			"Events", sol::readonly_property(&CurrentFile::getEvents)
 		);
@@ -582,6 +1869,16 @@ namespace Helix {
         Helix::edit(position, std::move(values));
     }
 
+	void PluginHelix::commitBatch (EditBatch&& batch) {
+		// So listeners never hear of a batch that is then refused
+		checkBatch(batch);
+		const std::optional<std::pair<AlphaFile::Natural, AlphaFile::Natural>> range = batch.getRange();
+		if (range.has_value()) {
+			current_file.events.triggerTemplate(current_file.events.keys.template get<int32_t>("Batch"), batch.getOperationCount(), static_cast<size_t>(range->first), static_cast<size_t>(range->second));
+		}
+		Helix::commitBatch(std::move(batch));
+	}
+
 
 
 #ifdef HELIX_USE_LUA_GUI
@@ -11,11 +11,18 @@
 #include <array>
 #include <variant>
 #include <map>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <chrono>
 
 #include <MlActions.hpp>
 #include <AlphaFile.hpp>
 #define HELIX_USE_LUA
 #define HELIX_USE_LUA_GUI
+/// Keep the counters reported by Helix::getStats. Without it they compile out.
+#define HELIX_USE_STATS
 #ifdef HELIX_USE_LUA
 
 // Ignore warnings from this header
@@ -32,10 +39,73 @@
 #endif
 
 #include "util.hpp"
+#include "PieceTable.hpp"
+#include "ActionArena.hpp"
+#include "EditIndex.hpp"
+#include "MappedFile.hpp"
+#include "Storage.hpp"
+#include "IOQueue.hpp"
+#include "FileCopy.hpp"
+#include "SaveJournal.hpp"
+#include "Stats.hpp"
+#include "Trace.hpp"
 
 namespace Helix {
+    /// Settings for writing actions into a file
+    struct SaveOptions {
+        /// Amount of bytes moved at a time when an insertion/deletion shifts the rest of the file
+        size_t chunk_size = 120;
+        /// Reused by edits to hand their payload to the file, as BasicFile::edit only takes a std::vector.
+        /// If this is nullptr each edit allocates its own.
+        std::vector<std::byte>* edit_buffer = nullptr;
+    };
+
+    struct BaseAction;
+
+    /// A compact, non-virtual form of the built-in actions.
+    /// The action list keeps these in one contiguous vector, so replaying actions dispatches with a switch instead of
+    /// a virtual call on a separately allocated object per action.
+    struct ActionRecord {
+        enum class Kind : uint8_t {
+            Edit,
+            Insertion,
+            Deletion,
+            /// Any other (user-defined) action, which is replayed through its own reversePosition
+            Opaque,
+        };
+
+        Kind kind;
+        AlphaFile::Natural position;
+        /// Edit: amount of bytes edited. Insertion/Deletion: amount of bytes inserted/deleted.
+        size_t amount;
+        union {
+            /// Edit: the edited bytes, owned by the action
+            const std::byte* data;
+            /// Opaque: the action itself
+            BaseAction* action;
+        };
+
+        static ActionRecord edit (AlphaFile::Natural t_position, const std::byte* t_data, size_t t_amount);
+        static ActionRecord insertion (AlphaFile::Natural t_position, size_t t_amount);
+        static ActionRecord deletion (AlphaFile::Natural t_position, size_t t_amount);
+        static ActionRecord opaque (BaseAction* t_action);
+
+        /// Same as BaseAction::reversePosition
+        std::variant<std::byte, AlphaFile::Natural> reversePosition (AlphaFile::Natural read_position) const;
+
+        /// Same as BaseAction::getSizeDifference
+        ptrdiff_t getSizeDifference () const;
+
+        /// Applies the action to the piece table. Must not be called on Opaque records.
+        void applyTo (PieceTable& table) const;
+    };
+
     struct BaseAction {
-        explicit BaseAction () {}
+        /// Unique per action ever created, so that anything derived from the action list can tell whether the
+        /// actions it was built from are still the ones in the list.
+        const uint64_t serial;
+
+        explicit BaseAction () : serial(next_serial++) {}
         virtual ~BaseAction () {}
 
         /// Returns the byte value (if somehow stored in the action)
@@ -51,15 +121,31 @@ namespace Helix {
         }
 
         virtual void save (AlphaFile::BasicFile& file) = 0;
+
+        /// Saves with the given options. Actions that don't care about them don't need to override this.
+        virtual void save (AlphaFile::BasicFile& file, const SaveOptions&) {
+            save(file);
+        }
+
+        /// Appends the compact form of this action to `records`.
+        /// By default the action is kept as an Opaque record, which is replayed with reversePosition.
+        virtual void appendRecords (std::vector<ActionRecord>& records) {
+            records.push_back(ActionRecord::opaque(this));
+        }
+
+        private:
+        inline static std::atomic<uint64_t> next_serial = 0;
     };
 
     // It is somewhat notable that the three basic Actions (Edit, Insertion, Deletion) don't have any custom code for undo/redo as they simply exist for storing data
     // Though they'll of course need custom code for actually saving to the file.
     struct EditAction : public BaseAction {
         AlphaFile::Natural position;
-        std::vector<std::byte> data;
+        std::pmr::vector<std::byte> data;
 
-        explicit EditAction (AlphaFile::Natural t_position, std::vector<std::byte>&& t_data) : position(t_position), data(t_data) {}
+        /// `resource` is where the data is stored, such as the action list's arena
+        explicit EditAction (AlphaFile::Natural t_position, std::vector<std::byte>&& t_data, std::pmr::memory_resource* resource=std::pmr::get_default_resource()) :
+            position(t_position), data(t_data.begin(), t_data.end(), resource) {}
 
         std::variant<std::byte, AlphaFile::Natural> reversePosition (AlphaFile::Natural read_position) override {
             if (data.size() == 0) {
@@ -78,7 +164,21 @@ namespace Helix {
         }
 
         void save (AlphaFile::BasicFile& file) override {
-            file.edit(position, data);
+            save(file, SaveOptions());
+        }
+
+        void save (AlphaFile::BasicFile& file, const SaveOptions& options) override {
+            if (options.edit_buffer == nullptr) {
+                file.edit(position, std::vector<std::byte>(data.begin(), data.end()));
+                return;
+            }
+            // Keeps its capacity, so saving many edits only allocates for the largest one
+            options.edit_buffer->assign(data.begin(), data.end());
+            file.edit(position, *options.edit_buffer);
+        }
+
+        void appendRecords (std::vector<ActionRecord>& records) override {
+            records.push_back(ActionRecord::edit(position, data.data(), data.size()));
         }
     };
     struct InsertionAction : public BaseAction {
@@ -109,8 +209,15 @@ namespace Helix {
         }
 
         void save (AlphaFile::BasicFile& file) override {
-            // TODO: pass in chunk_size somehow
-            file.insertion(position, amount, 120);
+            save(file, SaveOptions());
+        }
+
+        void save (AlphaFile::BasicFile& file, const SaveOptions& options) override {
+            file.insertion(position, amount, options.chunk_size);
+        }
+
+        void appendRecords (std::vector<ActionRecord>& records) override {
+            records.push_back(ActionRecord::insertion(position, amount));
         }
     };
     struct DeletionAction : public BaseAction {
@@ -129,12 +236,19 @@ namespace Helix {
 
         ptrdiff_t getSizeDifference () const override {
             // TODO: make sure amount is within range. Perhaps split large deletions up?
-            return static_cast<ptrdiff_t>(amount);
+            return -static_cast<ptrdiff_t>(amount);
         }
 
         void save (AlphaFile::BasicFile& file) override {
-            // TODO: pass in chunk_size somehow
-            file.deletion(position, amount, 120);
+            save(file, SaveOptions());
+        }
+
+        void save (AlphaFile::BasicFile& file, const SaveOptions& options) override {
+            file.deletion(position, amount, options.chunk_size);
+        }
+
+        void appendRecords (std::vector<ActionRecord>& records) override {
+            records.push_back(ActionRecord::deletion(position, amount));
         }
     };
     struct BundledAction : public BaseAction {
@@ -158,53 +272,226 @@ namespace Helix {
             return position;
         }
 
+        ptrdiff_t getSizeDifference () const override {
+            ptrdiff_t difference = 0;
+            for (const std::unique_ptr<BaseAction>& action_v : actions) {
+                difference += action_v->getSizeDifference();
+            }
+            return difference;
+        }
+
         void save (AlphaFile::BasicFile& file) override {
+            save(file, SaveOptions());
+        }
+
+        void save (AlphaFile::BasicFile& file, const SaveOptions& options) override {
+            for (std::unique_ptr<BaseAction>& action_v : actions) {
+                action_v->save(file, options);
+            }
+        }
+
+        /// Bundles are flattened into the records of their actions
+        void appendRecords (std::vector<ActionRecord>& records) override {
             for (std::unique_ptr<BaseAction>& action_v : actions) {
-                action_v->save(file);
+                action_v->appendRecords(records);
             }
         }
     };
 
-    class ActionListLink : public MlActions::ActionListLink<BaseAction> {
+    /// Holds the arena for ActionListLink.
+    /// It's a base class listed before MlActions::ActionListLink so that it is destroyed after it, as the actions
+    /// destroyed by MlActions::ActionListLink may have their payloads in the arena.
+    /// Held by pointer so that ActionListLink::replace can swap in an arena that new actions were built in.
+    struct ActionArenaOwner {
+        std::unique_ptr<ActionArena> arena = std::make_unique<ActionArena>();
+    };
+
+    class ActionListLink : protected ActionArenaOwner, public MlActions::ActionListLink<BaseAction> {
+        protected:
+
+        /// The records of every action in `data`, in order. Kept up to date with `data` by syncRecords.
+        std::vector<ActionRecord> records;
+        /// Where each recorded action's records start in `records`
+        std::vector<size_t> record_offsets;
+        /// Serial of each recorded action, used to find where `data` stops matching `records` after an undo
+        std::vector<uint64_t> record_serials;
+        /// The size difference of each recorded action plus all of those before it, so the difference of the whole
+        /// list is known without going over every action
+        std::vector<ptrdiff_t> size_totals;
+
+        /// The result of applying the records of the first `indexed_count` actions of `data`.
+        /// Built incrementally as actions are added, and rebuilt if the actions it was built from are undone.
+        PieceTable pieces;
+        /// Used instead of `pieces` when `edit_only` is set
+        EditIndex edits;
+        /// If the list only ever holds edits, so positions never shift
+        bool edit_only = false;
+        size_t indexed_count = 0;
+        /// Serial of the last action applied to `pieces`
+        uint64_t indexed_serial = 0;
+
+        enum class CoalesceKind {
+            None,
+            Edit,
+            Insertion,
+            Deletion,
+        };
+        /// Whether addEdit/addInsertion/addDeletion merge into the previous action when they're contiguous with it
+        bool coalescing = false;
+        /// The last action added through addEdit/addInsertion/addDeletion, which may be merged into.
+        /// Only valid while it's still the last action in `data`, which is checked with its serial.
+        BaseAction* coalesce_target = nullptr;
+        uint64_t coalesce_serial = 0;
+        CoalesceKind coalesce_kind = CoalesceKind::None;
+        /// Longest pause after the last coalescable action that the next one is still merged across
+        std::optional<std::chrono::steady_clock::duration> coalesce_interval;
+        /// When the last coalescable action was added or merged
+        std::chrono::steady_clock::time_point coalesce_time;
+        uint64_t revision = 0;
+        /// What the most recent merge added to the last action, see getLastMerge
+        std::optional<ActionRecord> last_merge;
+
         public:
+        /// Counted by readFromStorage
+        struct ReadCounters {
+            StatCounter lookups;
+            /// Records replayed in reverse, which aren't in the index
+            StatCounter records_walked;
+        };
 
-        explicit ActionListLink (MlActions::ActionList& action_list) : MlActions::ActionListLink<BaseAction>(action_list) {}
+        protected:
+        ReadCounters read_counters;
 
-        /// What this function does is applies the Actions in *reverse* until it finds an action which modified the position we're looking for.
-        /// Due to the way this works, if we don't find an Action that edited the position, then the new-position is the right place in the file to read!
-        std::variant<std::byte, AlphaFile::Natural> readFromStorage (AlphaFile::Natural natural_position) {
-            // TODO: have mlaction provide a useful function for this
-            for (auto iterator = this->data.rbegin(); iterator != this->data.rend(); ++iterator) {
-                std::unique_ptr<BaseAction>& action = *iterator;
+        public:
 
-                std::variant<std::byte, AlphaFile::Natural> result = action->reversePosition(natural_position);
+        /// Edits aren't merged past this size, since merging in front of an edit has to move its data
+        static constexpr size_t coalesce_max_edit_size = 64 * 1024;
 
-                if (std::holds_alternative<std::byte>(result)) {
-                    return std::get<std::byte>(result);
-                } else {
-                    natural_position = std::get<AlphaFile::Natural>(result);
-                }
-            }
-            return natural_position;
-        }
+        explicit ActionListLink (MlActions::ActionList& action_list) : MlActions::ActionListLink<BaseAction>(action_list) {}
 
-        size_t getSizeDifference (size_t value) {
-            // TODO: possibly make sure this doesn't go under 0 or over max
-            // TODO: also possibly make so the value is passed to it instead of merely adding to it
-            //       that would work better than returning ptrdiff_t, and allow more complicate size differences
-            for (auto& action : this->data) {
-                value += action->getSizeDifference();
+        /// Finds where the byte at `natural_position` comes from: either a byte stored in an action or a position in
+        /// the file before any modifications.
+        /// Actions in the piece table are resolved in O(log pieces). The records of any actions after the first one
+        /// that couldn't be indexed are applied in *reverse* until one modifies the position.
+        std::variant<std::byte, AlphaFile::Natural> readFromStorage (AlphaFile::Natural natural_position);
+
+        /// Calls `func` with the pieces covering [position, position + amount), see PieceTable::forEachPiece.
+        /// Returns false, without calling `func`, if there are actions that have to be replayed byte by byte instead.
+        template<typename Func>
+        bool readPieces (AlphaFile::Natural position, size_t amount, Func&& func) {
+            syncIndex();
+            if (indexed_count != this->data.size()) {
+                return false;
             }
-            return value;
-        }
 
-        void save (AlphaFile::BasicFile& file) {
-            for (auto& action : data) {
-                action->save(file);
+            if (edit_only) {
+                edits.forEachPiece(position, amount, std::forward<Func>(func));
+            } else {
+                pieces.forEachPiece(position, amount, std::forward<Func>(func));
             }
-            // TODO: undoing past a save would be really nice to have
-            list.clear();
+            return true;
         }
+
+        /// The bytes of a piece given by readPieces with Source::Buffer
+        const std::byte* getPieceData (const Piece& piece) const;
+
+        /// Amount of pieces in the index, mostly useful for judging how fragmented the edits are
+        size_t getPieceCount ();
+
+        /// Marks the list as only holding edits (such as in modes without insertion/deletion), which lets it index
+        /// them in an EditIndex rather than a PieceTable.
+        /// Any insertions/deletions that do get added are still handled, just without the index.
+        void setEditOnly (bool value);
+
+        /// `value` (the size of the unmodified file) changed by the actions.
+        /// Kept up to date as actions are added, merged into and undone, so this is O(1) unless the list changed.
+        size_t getSizeDifference (size_t value);
+
+        /// Writes the actions into the file. The actions are kept, so call clear once what was written is in place.
+        void save (AlphaFile::BasicFile& file, const SaveOptions& options=SaveOptions());
+        /// Saves the actions, calling `step` with how many have been written and how many there are before each one.
+        /// If `step` returns false then it stops there and returns false. Either way the actions are kept.
+        bool save (AlphaFile::BasicFile& file, const SaveOptions& options, const std::function<bool(size_t done, size_t total)>& step);
+
+        /// Makes contiguous edits, insertions and deletions be merged into a single action.
+        /// A merged run of actions is undone as one action, so undo no longer steps back one keystroke at a time. The
+        /// run ends at a pause longer than `interval` (if given), the way text editors group typing into undo steps,
+        /// and wherever breakCoalescing is called.
+        void setCoalescing (bool value, std::optional<std::chrono::steady_clock::duration> interval=std::nullopt);
+
+        /// Stops the next action from being merged into the previous ones
+        void breakCoalescing ();
+
+        void addEdit (AlphaFile::Natural position, std::vector<std::byte>&& values);
+        void addInsertion (AlphaFile::Natural position, size_t amount);
+        void addDeletion (AlphaFile::Natural position, size_t amount);
+
+        /// If every action only overwrites bytes, writes their end result into `index` (which should be empty) and
+        /// returns true. Otherwise returns false, with `index` left partially written.
+        bool collectEdits (EditIndex& index);
+
+        /// Amount of actions in the list
+        size_t getActionCount () const;
+        uint64_t getActionSerial (size_t action_index) const;
+        /// The records of the action at `action_index`, as [begin, end)
+        std::pair<const ActionRecord*, const ActionRecord*> getActionRecords (size_t action_index);
+        /// Changes whenever an action is changed by merging another into it, which doesn't change its serial
+        uint64_t getRevision () const;
+        /// What the most recent merge added to the action it merged into, which has the same result as making it
+        /// after that action as it was. Edit data points into the merged action, so it's only valid until that changes.
+        const std::optional<ActionRecord>& getLastMerge () const;
+        /// Serial of the last action in the list, if there is one
+        std::optional<uint64_t> getLastSerial () const;
+
+        /// Forgets all the actions, for once they've been written out.
+        /// This also releases the arena, as none of the actions using it are left.
+        /// That is the only point the arena is given back: payloads of actions that were undone and then dropped, or
+        /// that were replaced when merging, stay allocated until then (see ActionArena::getBytesUsed).
+        void clear ();
+
+        /// Forgets all the actions, replacing them with `new_actions`. Their payloads must be in `new_arena` (or not
+        /// in any arena), which replaces the list's arena.
+        void replace (std::vector<std::unique_ptr<BaseAction>>&& new_actions, std::unique_ptr<ActionArena>&& new_arena);
+
+        /// Where the payloads of actions in this list are stored
+        ActionArena& getArena ();
+
+        ReadCounters& getReadCounters ();
+        /// Bytes taken up by the records of the actions
+        size_t getRecordMemory () const;
+
+        protected:
+
+        /// Returns the action to merge into, if coalescing is on and it's still the last action and of the right kind
+        BaseAction* getCoalesceTarget (CoalesceKind kind);
+
+        /// Whether the coalesce target is in `pieces`, in which case changes to it also have to be made to `pieces`.
+        /// Must be called before changing the target, as the index is synced so that it holds the unchanged target.
+        bool isTargetIndexed ();
+
+        /// Re-records the coalesce target after it was changed
+        void refreshTargetRecords ();
+
+        void addCoalescable (std::unique_ptr<BaseAction>&& action, CoalesceKind kind);
+
+        /// Appends the size total of the action whose records start at `record_start`, which are the last records
+        void pushSizeTotal (size_t record_start);
+
+        /// Brings `records` up to date with `data`.
+        /// Actions are only ever added or removed at the end, so everything up to the last action whose serial still
+        /// matches is unchanged.
+        void syncRecords ();
+
+        /// Brings the index up to date with `data`, up until the first action that has a record that can't be indexed.
+        void syncIndex ();
+
+        /// Whether the record can be put in the index being used
+        bool isIndexable (const ActionRecord& record) const;
+        /// Applies the record to the index being used
+        void indexRecord (const ActionRecord& record);
+
+        /// Index in `records` where the records of the action at `action_index` start
+        size_t getRecordStart (size_t action_index) const;
     };
 
 
@@ -215,13 +502,101 @@ namespace Helix {
         /// Invalid destination. The path to the place to store the file is invalid.
         InvalidDestination,
         /// We can't write here :(
+        /// Also returned when writing fails part of the way, such as when running out of space, if the file wasn't
+        /// changed (see PartiallyWritten).
         InsufficientPermissions,
         /// Went over the iteration limit of looking for a temp filename. May be a sign of a bug.
         TempFileIterationLimit,
         /// Unsupported mode. This is probably a bug in this library.
+        /// Also returned by save when the storage isn't backed by a file (such as MemoryStorage), which can only be
+        /// saved with saveAs.
         InvalidMode,
+        /// The save was cancelled through its SaveControl. The file wasn't changed.
+        Cancelled,
+        /// Writing into the file itself (in-place saves) failed part of the way. The actions are kept.
+        /// With InPlaceSave::Journaled the journal is left, and the write is finished when the file is next opened.
+        /// With InPlaceSave::Direct the file may be left half written.
+        PartiallyWritten,
     };
 
+    /// The parts a save goes through, in the order they happen
+    enum class SavePhase {
+        /// Copying the file to the temp file (SaveStrategy::Replay)
+        Copy = 0,
+        /// Writing the edited file out sequentially (SaveStrategy::Stream and background saves)
+        Write,
+        /// Applying the actions to the temp file (SaveStrategy::Replay) or to the file itself (Partial saves)
+        Replay,
+        /// Cutting the temp file to its final size (SaveStrategy::Replay)
+        Resize,
+        /// Moving the temp file over the destination
+        Rename,
+    };
+
+    struct SaveProgress {
+        SavePhase phase;
+        /// How much of the phase is done, and how much there is. Bytes for Copy/Write, actions for Replay.
+        size_t done = 0;
+        size_t total = 0;
+    };
+
+    constexpr size_t save_phase_count = static_cast<size_t>(SavePhase::Rename) + 1;
+
+    /// Counters that Helix keeps of its hot paths, see HelixStats
+    struct StatCounters {
+        StatCounter reads_from_actions;
+        StatCounter reads_from_storage;
+        std::array<StatCounter, save_phase_count> bytes_written;
+    };
+
+    /// What Helix::getStats reports. Counters are all zero unless HELIX_USE_STATS is defined.
+    struct HelixStats {
+        /// Bytes read that came from actions (edited, inserted or filled bytes)
+        uint64_t reads_from_actions = 0;
+        /// Bytes read that came from the unmodified file
+        uint64_t reads_from_storage = 0;
+        /// Single byte lookups through the actions (ActionListLink::readFromStorage)
+        uint64_t action_lookups = 0;
+        /// Records replayed in reverse by those lookups, which were past what is in the index
+        uint64_t records_walked = 0;
+        /// Bytes written by Helix itself during saves, by SavePhase. Writes done by AlphaFile when replaying actions
+        /// aren't included.
+        std::array<uint64_t, save_phase_count> bytes_written = {};
+        /// Of the storage, if it is cached by Helix itself (see Helix::getCacheStats)
+        std::optional<CacheStats> cache;
+
+        size_t action_count = 0;
+        /// Bytes held by the arena that action payloads are stored in
+        size_t action_arena_bytes = 0;
+        /// Bytes taken up by the records of the actions
+        size_t action_record_bytes = 0;
+
+        double getAverageRecordsWalked () const;
+        uint64_t getBytesWritten (SavePhase phase) const;
+    };
+
+    using SaveProgressCallback = std::function<void(const SaveProgress& progress)>;
+
+    /// Lets a save be cancelled from another thread, such as the UI thread while the save runs in the background
+    class SaveCancellation {
+        public:
+        void cancel ();
+        bool isCancelled () const;
+
+        protected:
+        std::atomic<bool> cancelled = false;
+    };
+
+    /// Progress reporting and cancellation for a save, both of which are optional.
+    /// Cancelling removes the temp file and leaves the destination untouched. Saves that write into the file itself
+    /// (Partial saves) can't be cancelled, and only report progress.
+    struct SaveControl {
+        SaveProgressCallback progress = nullptr;
+        std::shared_ptr<SaveCancellation> cancellation = nullptr;
+
+        void report (SavePhase phase, size_t done, size_t total) const;
+        bool isCancelled () const;
+    };
 
     enum class SaveAsMode {
         // Saves the entire file
@@ -342,14 +717,76 @@ namespace Helix {
         }
     };
 
+    /// How a whole-file save produces the new file
+    enum class SaveStrategy {
+        /// Writes the edited view of the file from start to end, in large sequential writes.
+        /// Only usable when the view covers the entire file (no start/end), otherwise Replay is used.
+        Stream = 0,
+        /// Copies the file and then applies each action to the copy.
+        /// Every insertion/deletion shifts the rest of the file.
+        Replay,
+    };
+
+    /// Whether saving over the file, when every action only overwrites bytes, writes them straight into it instead of
+    /// writing a new file. Only used in modes that save the whole file, and only when saving over the file itself.
+    enum class InPlaceSave {
+        Off = 0,
+        /// The edited ranges are written into the file. If that is interrupted the file may be left half written.
+        Direct,
+        /// The edited ranges are written to a journal first (see SaveJournal), which is finished the next time the
+        /// file is opened if the save was interrupted.
+        Journaled,
+    };
+
+    /// Where unmodified bytes of the file are read from
+    enum class ReadBackend {
+        /// Through AlphaFile's block cache, sized by block_size and max_block_count
+        BlockCache = 0,
+        /// From a memory mapping of the file, so reads come straight from the OS page cache.
+        /// Falls back to BlockCache if the file can't be mapped.
+        MemoryMapped,
+    };
+
     struct Flags {
         size_t block_size = 1024;
         size_t max_block_count = 8;
+        /// Size of the block cache in bytes, used instead of max_block_count if set
+        std::optional<size_t> cache_size = std::nullopt;
+        /// How blocks are evicted from the cache. If this is nullopt then AlphaFile's own block cache is used.
+        /// Only used by the BlockCache read backend.
+        std::optional<CachePolicy> cache_policy = std::nullopt;
+        ReadBackend read_backend = ReadBackend::BlockCache;
+        /// Hint for how the file will be read, used by the MemoryMapped backend
+        AccessPattern access_pattern = AccessPattern::Normal;
+        /// Amount of blocks read ahead once reads go through the file in order, 0 to not read ahead.
+        /// Used with a cache_policy, where they are read along with the block that missed, and by the MemoryMapped
+        /// backend, where the OS is asked to start reading them in the background.
+        size_t read_ahead = 0;
+        SaveStrategy save_strategy = SaveStrategy::Stream;
+        InPlaceSave in_place_save = InPlaceSave::Off;
+        /// Chunk size used when insertions/deletions shift the file during a save.
+        /// If this is nullopt then it is picked from the file size and available memory.
+        std::optional<size_t> save_chunk_size = std::nullopt;
+        /// Merge contiguous edits/insertions/deletions into single actions, see ActionListLink::setCoalescing.
+        /// Each merged run is undone in one step, so this trades undo granularity for fewer actions.
+        bool coalesce_actions = false;
+        /// Pause after which the next action starts a new run (and so a new undo step), nullopt to only end runs at
+        /// breakCoalescing
+        std::optional<std::chrono::milliseconds> coalesce_interval = std::chrono::milliseconds(1000);
+        /// Keep a journal of the unsaved actions next to the file, see ActionJournal.
+        /// Only for storage that is backed by a file.
+        bool journal_actions = false;
+        /// How long after an action it is written to the disk in the journal, at most. Also how often that happens,
+        /// at most, as the actions made in the meantime are written together.
+        std::chrono::milliseconds journal_sync_interval = std::chrono::milliseconds(1000);
         FileModeInfo mode_info;
 
         explicit Flags (typename FileModeInfo::VariantType t_mode) : mode_info(std::move(t_mode)) {}
     };
 
+    class ActionJournal;
+    class EditBatch;
+
     class Helix {
         public:
 
@@ -361,7 +798,12 @@ namespace Helix {
 
         protected:
 
-        AlphaFile::BlockCachedFile<AlphaFile::ConstrainedFile> file;
+        /// Where the unmodified file is read from, picked by Flags::read_backend unless given directly
+        std::unique_ptr<Storage> storage;
+
+        SaveStrategy save_strategy;
+        InPlaceSave in_place_save;
+        std::optional<size_t> save_chunk_size;
 
         public:
 
@@ -369,10 +811,12 @@ namespace Helix {
 
         explicit Helix (MlActions::ActionList& action_list, std::filesystem::path t_filename, Flags t_hflags);
 
-        std::optional<size_t> cached_file_size;
-        std::optional<size_t> cached_editable_size;
+        /// Edits on top of the given storage rather than opening a file.
+        /// The storage is expected to already be constrained to the mode's start/end, and the flags for the block
+        /// cache and read backend are ignored.
+        explicit Helix (MlActions::ActionList& action_list, std::unique_ptr<Storage>&& t_storage, Flags t_hflags=Flags(WholeFileMode()));
 
-        void clearCaches ();
+        ~Helix ();
 
         /// If the file can be written to.
         /// If this is false, then the temp file (in mem) can be written to, but it can't be saved.
@@ -383,13 +827,39 @@ namespace Helix {
         /// Gets editable size of the file, UNCACHED
         size_t getEditableSize ();
 
-        /// Gets file size, CACHED
+        /// Same as getSize, which no longer needs a cache as the size is kept up to date as actions are made
         size_t getCachedSize ();
-        /// Gets editable size of the file, CACHED
+        /// Same as getEditableSize
         size_t getCachedEditableSize ();
 
         std::optional<std::byte> read (AlphaFile::Natural position);
         std::vector<std::byte> read (AlphaFile::Natural position, size_t amount);
+        /// Reads up to `amount` bytes into `output`, which must have room for them.
+        /// Returns the amount of bytes actually read, which is less than `amount` if the end of the file was reached.
+        size_t read (AlphaFile::Natural position, std::byte* output, size_t amount);
+
+        /// Changes the hint for how the file is read (only used when memory mapped)
+        void setAccessPattern (AccessPattern pattern);
+
+        /// If reads are served from a memory mapping of the file
+        bool isMapped () const;
+
+        Storage& getStorage ();
+
+        /// Hit/miss counts of the block cache, only kept when Flags::cache_policy is set.
+        /// Otherwise the caching is done inside AlphaFile's BlockCachedFile, which doesn't say whether a read hit or
+        /// missed, so this is nullopt.
+        std::optional<CacheStats> getCacheStats () const;
+
+        /// The counters of the read and save paths, along with the memory taken by the actions
+        HelixStats getStats ();
+        /// Zeroes the counters, including those of the block cache
+        void resetStats ();
+
+        /// Records the phases of saves (and, for PluginHelix, each Lua listener called) as spans of the tracer.
+        /// Null turns tracing off, which it is by default.
+        void setTracer (std::shared_ptr<Tracer> t_tracer);
+        const std::shared_ptr<Tracer>& getTracer () const;
 
         std::optional<uint8_t> readU8 (AlphaFile::Natural position);
         std::optional<uint16_t> readU16BE (AlphaFile::Natural Position);
@@ -414,24 +884,169 @@ namespace Helix {
         /// Called deletion because delete is a keyword :x
         void deletion (AlphaFile::Natural position, size_t amount);
 
-        SaveStatus save ();
+        /// Makes every change in the batch as one action, so it is undone in one step and the journal and index are
+        /// only brought up to date once. Throws, without changing anything, if the batch has insertions or deletions
+        /// and the mode doesn't support them.
+        void commitBatch (EditBatch&& batch);
+
+        SaveStatus save (const SaveControl& control=SaveControl());
+
+        SaveStatus saveAs (const std::filesystem::path& destination, const SaveControl& control=SaveControl());
+
+        // ==== Async ====
+        // These run on a worker thread owned by this Helix (see IOQueue), one after another in the order they were
+        // called, so that saving doesn't block the caller. The I/O itself is the same blocking I/O as the synchronous
+        // calls, on that one thread.
+        // Nothing else may use this Helix until the returned future is ready, other than queueing more async calls.
+        // That is also why there's no async read: the caller would have to wait for it before doing anything else.
+
+        std::future<SaveStatus> saveAsync (SaveControl control=SaveControl());
+
+        std::future<SaveStatus> saveAsAsync (const std::filesystem::path& destination, SaveControl control=SaveControl());
+
+        /// Whether there are async calls that haven't finished yet
+        bool hasPendingAsync ();
 
-        SaveStatus saveAs (const std::filesystem::path& destination);
+        /// How the file was copied by the last Replay save, if there was one
+        std::optional<CopyStrategy> getLastCopyStrategy () const;
+
+        // ==== Journal ====
+
+        /// Adds the actions from the journal left by an earlier session that wasn't saved (such as after a crash).
+        /// This has to be called before anything else is done, as the journal is started over on the first change.
+        /// Returns the amount of actions that were recovered.
+        size_t recoverActions ();
+
+        /// Writes the journal out to the disk now, rather than waiting for the sync interval.
+        /// Actions that were undone are only noticed here or on the next change.
+        void flushJournal ();
+
+        /// Removes the journal, such as when the unsaved actions are meant to be thrown away
+        void discardJournal ();
+
+        // ==== Session ====
+
+        /// Stores the actions in a session file (see SessionFile), so they can be loaded again later on top of the
+        /// unsaved file. Returns false if it couldn't be written or there are user-defined actions, which can't be stored.
+        bool saveSession (const std::filesystem::path& path);
+        /// Replaces the actions with those stored in the session file. Returns false, without changing anything, if it
+        /// can't be read or decoded, was stored on top of a different file (by its size and when it was last written
+        /// to), or a background save is running.
+        bool loadSession (const std::filesystem::path& path);
+
+        // ==== Background Save ====
+        // The edited file is written out on the worker thread from a snapshot of the actions, so editing can go on
+        // while it is saved. Only whole views (no start/end) of a file can be saved this way, other saves (and those
+        // with actions that can't be indexed) are done synchronously instead. So are saves after a background save
+        // that had actions made on top of it, as those still apply to the file from before it was replaced.
+        // The snapshot's actions are forgotten once the save is finished, if nothing was done on top of them since.
+
+        /// Starts saving over the file. Returns the status of starting, the status of the save itself is given by
+        /// pollBackgroundSave/waitBackgroundSave. Progress is reported from the worker thread.
+        SaveStatus saveInBackground (SaveControl control=SaveControl());
+        SaveStatus saveAsInBackground (const std::filesystem::path& destination, SaveControl control=SaveControl());
+
+        /// The status of the background save if it finished since the last call, otherwise nullopt
+        std::optional<SaveStatus> pollBackgroundSave ();
+        /// Waits for the background save to finish. Returns Success if there wasn't one.
+        SaveStatus waitBackgroundSave ();
+
+        bool isSavingInBackground () const;
 
         protected:
 
+        /// The view of the file when a background save started, which the save is written from
+        struct SaveSnapshot {
+            std::vector<Piece> pieces;
+            /// The bytes of pieces with Source::Buffer, copied out of the action list
+            std::vector<std::byte> buffer;
+            size_t size = 0;
+        };
+
+        std::optional<CopyStrategy> last_copy_strategy;
+
+        /// Set if Flags::journal_actions is
+        std::unique_ptr<ActionJournal> action_journal;
+
+        std::future<SaveStatus> background_save;
+        /// The actions that the background save is writing out, to tell whether anything was done since
+        size_t background_save_action_count = 0;
+        std::optional<uint64_t> background_save_serial;
+        bool background_save_replaces_file = false;
+
+        /// Set when a background save replaced the file while there were newer actions on top of the snapshot.
+        /// The storage still reads the contents that the actions apply to, but the file on disk doesn't hold them
+        /// anymore, so it can't be copied for a Replay save.
+        /// Cleared once a later save replaces the file again, at which point the storage is reopened on it.
+        bool storage_replaced = false;
+
+        StatCounters counters;
+        std::shared_ptr<Tracer> tracer;
+
+        /// Created on the first async call (or along with the action journal, which is flushed from it), so that a Helix
+        /// that is only used synchronously has no thread.
+        /// Declared last so it is destroyed (which waits for the queued calls) before anything they use.
+        std::unique_ptr<IOQueue> io_queue;
+
+        IOQueue& getIOQueue ();
+
+        /// Creates the storage for the file, as chosen by the flags
+        static std::unique_ptr<Storage> createStorage (const std::filesystem::path& filename, AlphaFile::OpenFlags flags, const Flags& t_hflags);
+
+        void initActions (const Flags& t_hflags);
+
+        /// Throws if the batch has insertions or deletions and the mode doesn't support them
+        void checkBatch (const EditBatch& batch) const;
+
+        /// Brings the journal up to date after the actions changed
+        void journalActions ();
+        /// Starts the journal over after a save, if the actions were all written out
+        void journalSaved ();
+
+        /// Reads from the unmodified file
+        std::optional<std::byte> readStorage (AlphaFile::Natural position);
+        size_t readStorage (AlphaFile::Natural position, std::byte* output, size_t amount);
+
         static constexpr size_t save_as_write_amount = 512; // bytes at a time
         static constexpr size_t save_max_temp_filename_iteration = 10;
+        /// How much is read and written at once when streaming the file out
+        static constexpr size_t save_stream_chunk_size = 1024 * 1024;
+        /// How much is copied at once when the kernel copies the file, which is only that small to report progress
+        static constexpr size_t save_copy_chunk_size = 64 * 1024 * 1024;
+        /// Bounds for the automatically chosen chunk size
+        static constexpr size_t save_min_chunk_size = 64 * 1024;
+        static constexpr size_t save_max_chunk_size = 64 * 1024 * 1024;
 
 
         /// A simple save that directly writes to the file.
         /// Does not allow insertion/deletion and just ignores them if they exist
         /// (Though it should *not* be called if there is insertions/deletions in the first place..)
-        SaveStatus save_file_simple ();
-
-        SaveStatus saveAsFile (const std::filesystem::path& initial_destination);
+        SaveStatus save_file_simple (const SaveControl& control);
+
+        /// Checks the destination and finds a temp file next to it to write into
+        SaveStatus save_prepareDestination (const std::filesystem::path& initial_destination, std::filesystem::path& destination, std::filesystem::path& temp_file_path);
+        /// Writes the edits straight into the file, if the actions allow it (see InPlaceSave).
+        /// Returns nullopt if they don't, in which case nothing was done.
+        std::optional<SaveStatus> save_writeInPlace (const SaveControl& control);
+        SaveStatus saveAsFile (const std::filesystem::path& initial_destination, const SaveControl& control);
+        /// Writes the edited view into the temp file sequentially, touching each byte once. (SaveStrategy::Stream)
+        SaveStatus save_writeStreamed (const std::filesystem::path& temp_file_path, const SaveControl& control);
+        /// Copies the file to the temp file and applies the actions to it. (SaveStrategy::Replay)
+        SaveStatus save_writeReplayed (const std::filesystem::path& temp_file_path, const SaveControl& control);
+        /// Copies the file in chunks (or as a reflink), so that it can report progress and be cancelled.
+        /// Returns Cancelled if the control stopped it, or InsufficientPermissions if copying failed. Either way the
+        /// temp file is removed.
+        SaveStatus save_copyFile (const std::filesystem::path& source_path, const std::filesystem::path& temp_file_path, size_t size, const SaveControl& control);
         bool save_hasValidFilename (const std::filesystem::path& file_path);
         size_t save_calculateResultingFileSize (size_t previous_file_size);
+        /// The chunk size to shift the file with, see Flags::save_chunk_size
+        size_t save_calculateChunkSize (size_t file_size);
+        SaveOptions save_getOptions (size_t file_size);
+        /// Writes the snapshot into the temp file and renames it to the destination. Runs on the worker thread, so it
+        /// must not touch the Helix.
+        static SaveStatus save_writeSnapshot (const SaveSnapshot& snapshot, const std::filesystem::path& source_path, const std::filesystem::path& temp_file_path, const std::filesystem::path& destination, const SaveControl& control, StatCounters& counters, Tracer* save_tracer);
+        /// Applies the result of the finished background save
+        SaveStatus save_finishBackground ();
         /// generates filenames in the form: [filename].[4 byte hex].tmp
         std::filesystem::path save_generateTempFilename (std::filesystem::path filename);
         std::optional<std::pair<std::filesystem::path, std::filesystem::path>> save_generateTempPath (const std::filesystem::path& destination);
@@ -461,14 +1076,20 @@ namespace Helix {
             return objects;
         }
 
+        /// Where the function was defined, as source:line
+        std::string describeFunction (const sol::function& func);
+
         struct Events {
             std::map<int32_t, std::vector<sol::function>> listeners;
 
             int32_t current_id = 0;
             // The currently created events
             sol::table keys;
+            std::map<int32_t, std::string> names;
+            /// The tracer of the Helix the events are for, which each listener call is recorded in
+            const std::shared_ptr<Tracer>* tracer;
 
-            explicit Events (sol::table t_keys);
+            explicit Events (sol::table t_keys, const std::shared_ptr<Tracer>& t_tracer);
 
             sol::table getKeys ();
 
@@ -476,18 +1097,37 @@ namespace Helix {
 
             template<typename... Types>
             void triggerTemplate (int32_t key, Types... values) {
-                if (std::vector<sol::function>* event_listeners = util::mapFindEntry(listeners, key)) {
-                    for (sol::function& func : *event_listeners) {
-                        func(values...);
-                    }
-                }
+                callListeners(key, [&] (sol::function& func) {
+                    func(values...);
+                });
             }
 
+            /// Name the event type was created with
+            std::string_view getName (int32_t key) const;
+
             void triggerLua (int32_t key, sol::variadic_args va);
 
             // TODO: remove function to remove a specific listeners
 
             int32_t createEventType (std::string name);
+
+            protected:
+            /// Calls `call` with each listener of the event, in a trace span of its own
+            template<typename Func>
+            void callListeners (int32_t key, Func&& call) {
+                if (std::vector<sol::function>* event_listeners = util::mapFindEntry(listeners, key)) {
+                    Tracer* event_tracer = tracer->get();
+                    for (size_t index = 0; index < event_listeners->size(); index++) {
+                        sol::function& func = (*event_listeners)[index];
+                        TraceSpan span(event_tracer, event_tracer ? getName(key) : std::string_view(), "lua");
+                        if (event_tracer) {
+                            span.addArg("listener", index);
+                            span.addArg("function", describeFunction(func));
+                        }
+                        call(func);
+                    }
+                }
+            }
         };
     };
 
@@ -513,6 +1153,9 @@ namespace Helix {
             SaveStatus save ();
 
             SaveStatus saveAs (std::string filename);
+
+            /// Helix::getStats, as a table
+            sol::table getStats ();
         };
         protected:
 
@@ -547,6 +1190,11 @@ namespace Helix {
         // TODO: some utility func to turn a list of parameters into a sol::variadic_args
         // remember to look at docs
         void edit (AlphaFile::Natural position, std::vector<std::byte>&& values);
+
+        /// Triggers the Batch event once, with the amount of changes and the range they touch, rather than an event
+        /// per change. Unlike Edit, listeners can't alter the values.
+        /// A batch that the mode doesn't support throws before the event is triggered.
+        void commitBatch (EditBatch&& batch);
     };
 
 #ifdef HELIX_USE_LUA_GUI
@@ -0,0 +1,73 @@
+#include "IOQueue.hpp"
+
+namespace Helix {
+	// ==== IOQueue:Constructors ====
+	IOQueue::IOQueue () : worker([this] () { run(); }) {}
+
+	IOQueue::~IOQueue () {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		condition.notify_all();
+		worker.join();
+	}
+
+	// ==== IOQueue ====
+	size_t IOQueue::getPendingCount () {
+		std::lock_guard<std::mutex> lock(mutex);
+		return jobs.size() + (running ? 1 : 0);
+	}
+
+	void IOQueue::push (std::function<void()>&& job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(std::move(job));
+		}
+		condition.notify_one();
+	}
+
+	void IOQueue::schedule (std::chrono::steady_clock::time_point time, std::function<void()>&& job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			scheduled.emplace(time, std::move(job));
+		}
+		// The worker may be waiting for a later scheduled job
+		condition.notify_one();
+	}
+
+	void IOQueue::run () {
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				running = false;
+				while (true) {
+					// Scheduled jobs whose time has come (or every one of them, when stopping) join the queue
+					const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+					while (!scheduled.empty() && (stopping || scheduled.begin()->first <= now)) {
+						jobs.push_back(std::move(scheduled.begin()->second));
+						scheduled.erase(scheduled.begin());
+					}
+					if (stopping || !jobs.empty()) {
+						break;
+					}
+
+					if (scheduled.empty()) {
+						condition.wait(lock);
+					} else {
+						condition.wait_until(lock, scheduled.begin()->first);
+					}
+				}
+				// Finish what was already queued before stopping
+				if (jobs.empty()) {
+					return;
+				}
+				job = std::move(jobs.front());
+				jobs.pop_front();
+				running = true;
+			}
+			job();
+		}
+	}
+} // namespace Helix
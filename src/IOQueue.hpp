@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <type_traits>
+
+namespace Helix {
+    /// Runs jobs on a worker thread, one at a time, in the order they were submitted.
+    /// Since the jobs never run at the same time as each other they can share state that isn't thread safe, as long as
+    /// nothing else touches it while they're queued.
+    class IOQueue {
+        public:
+        explicit IOQueue ();
+        /// Waits for every job that was already submitted to finish
+        ~IOQueue ();
+
+        IOQueue (const IOQueue&) = delete;
+        IOQueue& operator= (const IOQueue&) = delete;
+
+        /// Queues `func`, returning a future for its result (or for the exception it threw)
+        template<typename Func>
+        std::future<std::invoke_result_t<Func>> submit (Func&& func) {
+            using Result = std::invoke_result_t<Func>;
+            // std::function has to be copyable, which packaged_task isn't
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+            std::future<Result> result = task->get_future();
+            push([task] () {
+                (*task)();
+            });
+            return result;
+        }
+
+        /// Queues `job` to run once `time` has come, after the jobs queued before then.
+        /// Jobs still waiting for their time when the queue is destroyed are run right away.
+        void schedule (std::chrono::steady_clock::time_point time, std::function<void()>&& job);
+
+        /// Amount of jobs that haven't finished yet, not counting scheduled jobs that are still waiting for their time
+        size_t getPendingCount ();
+
+        protected:
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<std::function<void()>> jobs;
+        /// Jobs waiting for their time, which are moved to the end of `jobs` once it comes
+        std::multimap<std::chrono::steady_clock::time_point, std::function<void()>> scheduled;
+        /// Whether a job is currently running, which isn't in `jobs` anymore
+        bool running = false;
+        bool stopping = false;
+        std::thread worker;
+
+        void push (std::function<void()>&& job);
+        void run ();
+    };
+} // namespace Helix
@@ -0,0 +1,129 @@
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HELIX_HAS_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Helix {
+	// ==== MappedFile:Constructors ====
+	MappedFile::MappedFile (const std::filesystem::path& filename, std::optional<AlphaFile::Absolute> start, std::optional<AlphaFile::Absolute> end) {
+#ifdef HELIX_HAS_MMAP
+		const int descriptor = ::open(filename.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			return;
+		}
+
+		struct stat file_stat;
+		if (fstat(descriptor, &file_stat) != 0) {
+			::close(descriptor);
+			return;
+		}
+
+		const size_t file_size = static_cast<size_t>(file_stat.st_size);
+		const size_t view_start = std::min(static_cast<size_t>(start.value_or(0)), file_size);
+		const size_t view_end = std::clamp(static_cast<size_t>(end.value_or(file_size)), view_start, file_size);
+
+		// mmap wants a page aligned offset, so map from the page the view starts in
+		page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		const size_t mapping_offset = view_start - (view_start % page_size);
+		mapping_size = view_end - mapping_offset;
+
+		if (mapping_size == 0) {
+			// Nothing to map, which mmap doesn't allow anyway
+			::close(descriptor);
+			mapped = true;
+			return;
+		}
+
+		void* result = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, descriptor, static_cast<off_t>(mapping_offset));
+		// The mapping stays valid after the descriptor is closed
+		::close(descriptor);
+		if (result == MAP_FAILED) {
+			mapping_size = 0;
+			return;
+		}
+
+		mapping = result;
+		data = static_cast<const std::byte*>(mapping) + (view_start - mapping_offset);
+		size = view_end - view_start;
+		mapped = true;
+#endif
+	}
+
+	MappedFile::~MappedFile () {
+#ifdef HELIX_HAS_MMAP
+		if (mapping != nullptr) {
+			munmap(mapping, mapping_size);
+		}
+#endif
+	}
+
+	// ==== MappedFile:Public ====
+	bool MappedFile::isMapped () const {
+		return mapped;
+	}
+
+	void MappedFile::advise (AccessPattern pattern) {
+#ifdef HELIX_HAS_MMAP
+		if (mapping == nullptr) {
+			return;
+		}
+
+		int advice = MADV_NORMAL;
+		switch (pattern) {
+			case AccessPattern::Normal:
+				advice = MADV_NORMAL;
+				break;
+			case AccessPattern::Sequential:
+				advice = MADV_SEQUENTIAL;
+				break;
+			case AccessPattern::Random:
+				advice = MADV_RANDOM;
+				break;
+		}
+		// Only a hint, so failing isn't a problem
+		madvise(mapping, mapping_size, advice);
+#endif
+	}
+
+	void MappedFile::prefetch (AlphaFile::Natural position, size_t amount) {
+#ifdef HELIX_HAS_MMAP
+		if (mapping == nullptr || position >= size) {
+			return;
+		}
+		amount = std::min(amount, static_cast<size_t>(size - position));
+
+		// madvise wants a page aligned address
+		const std::byte* start = data + position;
+		const size_t misalignment = static_cast<size_t>(reinterpret_cast<uintptr_t>(start) % page_size);
+		madvise(const_cast<std::byte*>(start - misalignment), amount + misalignment, MADV_WILLNEED);
+#endif
+	}
+
+	std::optional<std::byte> MappedFile::read (AlphaFile::Natural position) const {
+		if (position >= size) {
+			return std::nullopt;
+		}
+		return data[position];
+	}
+
+	size_t MappedFile::read (AlphaFile::Natural position, std::byte* output, size_t amount) const {
+		if (position >= size) {
+			return 0;
+		}
+		amount = std::min(amount, static_cast<size_t>(size - position));
+		std::memcpy(output, data + position, amount);
+		return amount;
+	}
+
+	size_t MappedFile::getSize () const {
+		return size;
+	}
+} // namespace Helix
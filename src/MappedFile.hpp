@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <filesystem>
+
+#include <AlphaFile.hpp>
+
+namespace Helix {
+    /// How a file is expected to be read, passed on to the OS as a hint
+    enum class AccessPattern {
+        Normal = 0,
+        /// Reading from start to end, so reading ahead is worth it
+        Sequential,
+        /// Jumping around, so reading ahead is wasted
+        Random,
+    };
+
+    /// A read-only memory mapping of a file (or the [start, end) part of it).
+    /// Reads are served straight from the OS page cache, without going through a cache of our own.
+    /// Only available on POSIX systems, elsewhere isMapped is always false.
+    class MappedFile {
+        public:
+        explicit MappedFile (const std::filesystem::path& filename, std::optional<AlphaFile::Absolute> start=std::nullopt, std::optional<AlphaFile::Absolute> end=std::nullopt);
+        ~MappedFile ();
+
+        MappedFile (const MappedFile&) = delete;
+        MappedFile& operator= (const MappedFile&) = delete;
+
+        /// If mapping the file failed (or isn't supported) then nothing can be read
+        bool isMapped () const;
+
+        void advise (AccessPattern pattern);
+
+        /// Asks the OS to start reading [position, position + amount) into the page cache, without waiting for it
+        void prefetch (AlphaFile::Natural position, size_t amount);
+
+        std::optional<std::byte> read (AlphaFile::Natural position) const;
+        /// Copies up to `amount` bytes into output, returning how many there were
+        size_t read (AlphaFile::Natural position, std::byte* output, size_t amount) const;
+
+        size_t getSize () const;
+
+        protected:
+        /// The start of the mapping, which is page aligned
+        void* mapping = nullptr;
+        size_t mapping_size = 0;
+        /// The readable part of the mapping
+        const std::byte* data = nullptr;
+        size_t size = 0;
+        size_t page_size = 1;
+        bool mapped = false;
+    };
+} // namespace Helix
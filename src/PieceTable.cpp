@@ -0,0 +1,300 @@
+#include "PieceTable.hpp"
+
+namespace Helix {
+	// ==== Piece ====
+	Piece Piece::advanced (size_t amount) const {
+		Piece result = *this;
+		// Fill pieces don't refer to anything, so there is no offset to move
+		if (source != Source::Fill) {
+			result.offset += amount;
+		}
+		result.length -= amount;
+		return result;
+	}
+
+	// ==== PieceTable:Constructors ====
+	PieceTable::PieceTable () {
+		clear();
+	}
+
+	// ==== PieceTable:Public ====
+	void PieceTable::clear () {
+		nodes.clear();
+		free_nodes.clear();
+		buffer.clear();
+		buffer_live = 0;
+		piece_count = 0;
+
+		Piece file_piece;
+		file_piece.source = Piece::Source::File;
+		file_piece.offset = 0;
+		file_piece.length = unbounded_length;
+		root = createNode(file_piece);
+	}
+
+	std::variant<std::byte, AlphaFile::Natural> PieceTable::lookup (AlphaFile::Natural position) const {
+		NodeIndex index = root;
+		while (index != null_node) {
+			const Node& node = nodes[index];
+			const size_t left_total = getTotal(node.left);
+
+			if (position < left_total) {
+				index = node.left;
+			} else if (position < left_total + node.piece.length) {
+				const size_t inner = position - left_total;
+				switch (node.piece.source) {
+					case Piece::Source::File:
+					default:
+						return AlphaFile::Natural(node.piece.offset + inner);
+					case Piece::Source::Buffer:
+						return buffer[node.piece.offset + inner];
+					case Piece::Source::Fill:
+						return node.piece.fill;
+				}
+			} else {
+				position -= left_total + node.piece.length;
+				index = node.right;
+			}
+		}
+		// Past the end of the (unbounded) table, which shouldn't be reachable with real positions.
+		return position;
+	}
+
+	void PieceTable::write (AlphaFile::Natural position, const std::vector<std::byte>& data) {
+		write(position, data.data(), data.size());
+	}
+	void PieceTable::write (AlphaFile::Natural position, const std::byte* data, size_t length) {
+		if (length == 0) {
+			return;
+		}
+
+		Piece piece;
+		piece.source = Piece::Source::Buffer;
+		piece.offset = buffer.size();
+		piece.length = length;
+		buffer.insert(buffer.end(), data, data + length);
+		buffer_live += length;
+
+		erase(position, length);
+		insertPiece(position, piece);
+
+		if (buffer.size() >= compact_min_size && buffer_live < buffer.size() / 4) {
+			compactBuffer();
+		}
+	}
+
+	void PieceTable::insert (AlphaFile::Natural position, size_t amount, std::byte fill) {
+		if (amount == 0) {
+			return;
+		}
+
+		Piece piece;
+		piece.source = Piece::Source::Fill;
+		piece.fill = fill;
+		piece.length = amount;
+		insertPiece(position, piece);
+	}
+
+	void PieceTable::erase (AlphaFile::Natural position, size_t amount) {
+		if (amount == 0) {
+			return;
+		}
+
+		NodeIndex left;
+		NodeIndex rest;
+		NodeIndex middle;
+		NodeIndex right;
+		split(root, position, left, rest);
+		split(rest, amount, middle, right);
+		destroyTree(middle);
+		root = merge(left, right);
+	}
+
+	size_t PieceTable::getPieceCount () const {
+		return piece_count;
+	}
+
+	// ==== PieceTable:Internal ====
+	PieceTable::NodeIndex PieceTable::createNode (const Piece& piece, uint32_t priority) {
+		Node node;
+		node.piece = piece;
+		node.total = piece.length;
+		node.priority = priority;
+
+		piece_count++;
+		if (!free_nodes.empty()) {
+			const NodeIndex index = free_nodes.back();
+			free_nodes.pop_back();
+			nodes[index] = node;
+			return index;
+		}
+		nodes.push_back(node);
+		return static_cast<NodeIndex>(nodes.size() - 1);
+	}
+	PieceTable::NodeIndex PieceTable::createNode (const Piece& piece) {
+		return createNode(piece, static_cast<uint32_t>(engine()));
+	}
+
+	void PieceTable::destroyTree (NodeIndex index) {
+		// Iterative, since the subtree being removed may be large
+		std::vector<NodeIndex> pending;
+		if (index != null_node) {
+			pending.push_back(index);
+		}
+		while (!pending.empty()) {
+			const NodeIndex current = pending.back();
+			pending.pop_back();
+			if (nodes[current].left != null_node) {
+				pending.push_back(nodes[current].left);
+			}
+			if (nodes[current].right != null_node) {
+				pending.push_back(nodes[current].right);
+			}
+			if (nodes[current].piece.source == Piece::Source::Buffer) {
+				buffer_live -= nodes[current].piece.length;
+			}
+			free_nodes.push_back(current);
+			piece_count--;
+		}
+	}
+
+	size_t PieceTable::getTotal (NodeIndex index) const {
+		if (index == null_node) {
+			return 0;
+		}
+		return nodes[index].total;
+	}
+
+	void PieceTable::update (NodeIndex index) {
+		Node& node = nodes[index];
+		node.total = getTotal(node.left) + node.piece.length + getTotal(node.right);
+	}
+
+	void PieceTable::split (NodeIndex index, size_t position, NodeIndex& left, NodeIndex& right) {
+		if (index == null_node) {
+			left = null_node;
+			right = null_node;
+			return;
+		}
+
+		const size_t left_total = getTotal(nodes[index].left);
+		const size_t piece_length = nodes[index].piece.length;
+
+		if (position <= left_total) {
+			NodeIndex inner_right;
+			split(nodes[index].left, position, left, inner_right);
+			nodes[index].left = inner_right;
+			update(index);
+			right = index;
+		} else if (position >= left_total + piece_length) {
+			NodeIndex inner_left;
+			split(nodes[index].right, position - left_total - piece_length, inner_left, right);
+			nodes[index].right = inner_left;
+			update(index);
+			left = index;
+		} else {
+			// The split lands inside of this piece, so it becomes two pieces.
+			// The new node takes over the right subtree and keeps the same priority, so both halves are still valid
+			// treaps.
+			const size_t inner = position - left_total;
+			const Piece tail = nodes[index].piece.advanced(inner);
+			// Note: createNode may reallocate `nodes`, so no references are held across it
+			const NodeIndex tail_index = createNode(tail, nodes[index].priority);
+
+			nodes[tail_index].right = nodes[index].right;
+			update(tail_index);
+
+			nodes[index].piece.length = inner;
+			nodes[index].right = null_node;
+			update(index);
+
+			left = index;
+			right = tail_index;
+		}
+	}
+
+	PieceTable::NodeIndex PieceTable::merge (NodeIndex left, NodeIndex right) {
+		if (left == null_node) {
+			return right;
+		} else if (right == null_node) {
+			return left;
+		}
+
+		if (nodes[left].priority > nodes[right].priority) {
+			nodes[left].right = merge(nodes[left].right, right);
+			update(left);
+			return left;
+		} else {
+			nodes[right].left = merge(left, nodes[right].left);
+			update(right);
+			return right;
+		}
+	}
+
+	bool PieceTable::extendLast (NodeIndex index, const Piece& piece) {
+		if (index == null_node) {
+			return false;
+		}
+
+		std::vector<NodeIndex> spine;
+		for (NodeIndex current = index; current != null_node; current = nodes[current].right) {
+			spine.push_back(current);
+		}
+
+		Piece& last = nodes[spine.back()].piece;
+		if (last.source != piece.source) {
+			return false;
+		}
+
+		const bool contiguous = piece.source == Piece::Source::Fill ?
+			last.fill == piece.fill :
+			last.offset + last.length == piece.offset;
+		if (!contiguous) {
+			return false;
+		}
+
+		last.length += piece.length;
+		for (NodeIndex current : spine) {
+			nodes[current].total += piece.length;
+		}
+		return true;
+	}
+
+	void PieceTable::insertPiece (AlphaFile::Natural position, const Piece& piece) {
+		NodeIndex left;
+		NodeIndex right;
+		split(root, position, left, right);
+
+		if (!extendLast(left, piece)) {
+			left = merge(left, createNode(piece));
+		}
+		root = merge(left, right);
+	}
+
+	void PieceTable::compactBuffer () {
+		std::vector<std::byte> compacted;
+		compacted.reserve(buffer_live);
+
+		// In order, so pieces that end up next to each other in both the file and the buffer can still be extended
+		std::vector<NodeIndex> pending;
+		NodeIndex current = root;
+		while (current != null_node || !pending.empty()) {
+			while (current != null_node) {
+				pending.push_back(current);
+				current = nodes[current].left;
+			}
+			current = pending.back();
+			pending.pop_back();
+
+			Piece& piece = nodes[current].piece;
+			if (piece.source == Piece::Source::Buffer) {
+				const size_t offset = compacted.size();
+				compacted.insert(compacted.end(), buffer.begin() + piece.offset, buffer.begin() + piece.offset + piece.length);
+				piece.offset = offset;
+			}
+			current = nodes[current].right;
+		}
+
+		buffer = std::move(compacted);
+	}
+} // namespace Helix
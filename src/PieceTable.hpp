@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <variant>
+#include <random>
+#include <limits>
+#include <algorithm>
+
+#include <AlphaFile.hpp>
+
+namespace Helix {
+    /// A contiguous run of bytes in the natural (edited) view of the file.
+    struct Piece {
+        enum class Source : uint8_t {
+            /// Bytes come from the underlying file, starting at `offset`
+            File,
+            /// Bytes come from the piece table's own buffer, starting at `offset`
+            Buffer,
+            /// Every byte is `fill`
+            Fill,
+        };
+
+        Source source = Source::File;
+        std::byte fill = std::byte(0x00);
+        size_t offset = 0;
+        size_t length = 0;
+
+        /// Returns this piece with the first `amount` bytes dropped from it
+        Piece advanced (size_t amount) const;
+    };
+
+    /// Maps natural positions to where their byte actually lives, so that lookups don't depend on how many actions
+    /// have been made.
+    /// The pieces are kept in an implicit treap (ordered by position, balanced by random priorities) where each node
+    /// knows the total length of its subtree, so finding, splitting and joining at a position are O(log pieces).
+    class PieceTable {
+        public:
+        /// The length of the file piece that the table starts out with.
+        /// Positions past the end of the file still map to file offsets, the same as replaying the actions does.
+        static constexpr size_t unbounded_length = std::numeric_limits<size_t>::max() / 4;
+
+        explicit PieceTable ();
+
+        /// Resets the table back to a single unmodified view of the file
+        void clear ();
+
+        /// Returns the byte at the position if it's stored in the table, otherwise the offset into the file to read
+        std::variant<std::byte, AlphaFile::Natural> lookup (AlphaFile::Natural position) const;
+
+        /// Overwrites [position, position + data.size()) with data
+        void write (AlphaFile::Natural position, const std::vector<std::byte>& data);
+        void write (AlphaFile::Natural position, const std::byte* data, size_t length);
+        /// Inserts `amount` bytes of `fill` at position, shifting everything after it
+        void insert (AlphaFile::Natural position, size_t amount, std::byte fill);
+        /// Removes [position, position + amount), shifting everything after it back
+        void erase (AlphaFile::Natural position, size_t amount);
+
+        /// Calls `func` with every piece overlapping [position, position + amount), in order, trimmed to that range.
+        /// `func` returns false to stop early.
+        template<typename Func>
+        void forEachPiece (AlphaFile::Natural position, size_t amount, Func&& func) const {
+            forEachPieceIn(root, position, amount, func);
+        }
+
+        /// The bytes of a piece with Source::Buffer, valid until the table is next written to
+        const std::byte* getBufferData (const Piece& piece) const {
+            return buffer.data() + piece.offset;
+        }
+
+        size_t getPieceCount () const;
+
+        protected:
+        using NodeIndex = uint32_t;
+        static constexpr NodeIndex null_node = std::numeric_limits<NodeIndex>::max();
+
+        struct Node {
+            Piece piece;
+            /// Length of every piece in this subtree, including this one
+            size_t total;
+            uint32_t priority;
+            NodeIndex left = null_node;
+            NodeIndex right = null_node;
+        };
+
+        /// Nodes are stored in one vector, and referred to by index, to avoid an allocation per piece
+        std::vector<Node> nodes;
+        std::vector<NodeIndex> free_nodes;
+        /// Holds the data of every write, pieces with Source::Buffer refer into this
+        std::vector<std::byte> buffer;
+        /// Bytes of `buffer` that pieces still refer to, the rest was overwritten or erased
+        size_t buffer_live = 0;
+        NodeIndex root = null_node;
+        size_t piece_count = 0;
+        std::minstd_rand engine;
+
+        /// The buffer isn't compacted while it's smaller than this, as there's little to gain
+        static constexpr size_t compact_min_size = 64 * 1024;
+
+        NodeIndex createNode (const Piece& piece, uint32_t priority);
+        NodeIndex createNode (const Piece& piece);
+        void destroyTree (NodeIndex index);
+
+        size_t getTotal (NodeIndex index) const;
+        void update (NodeIndex index);
+
+        /// Splits the tree into [0, position) and [position, end), splitting a piece in two if needed
+        void split (NodeIndex index, size_t position, NodeIndex& left, NodeIndex& right);
+        NodeIndex merge (NodeIndex left, NodeIndex right);
+
+        /// Tries to grow the last piece of the tree to also cover `piece`, which avoids creating a new piece for
+        /// consecutive writes.
+        bool extendLast (NodeIndex index, const Piece& piece);
+
+        void insertPiece (AlphaFile::Natural position, const Piece& piece);
+
+        /// Copies the bytes that pieces still refer to into a new buffer, once most of the buffer is dead.
+        /// Pointers from getBufferData are only valid until the next write because of this.
+        void compactBuffer ();
+
+        /// `position` is relative to the start of the subtree. Returns false if `func` asked to stop.
+        template<typename Func>
+        bool forEachPieceIn (NodeIndex index, size_t position, size_t amount, Func& func) const {
+            if (index == null_node || amount == 0) {
+                return true;
+            }
+
+            const Node& node = nodes[index];
+            const size_t left_total = getTotal(node.left);
+
+            if (position < left_total) {
+                const size_t left_amount = std::min(amount, left_total - position);
+                if (!forEachPieceIn(node.left, position, left_amount, func)) {
+                    return false;
+                }
+                position += left_amount;
+                amount -= left_amount;
+                if (amount == 0) {
+                    return true;
+                }
+            }
+
+            const size_t inner = position - left_total;
+            if (inner < node.piece.length) {
+                Piece piece = node.piece.advanced(inner);
+                piece.length = std::min(amount, piece.length);
+                if (!func(piece)) {
+                    return false;
+                }
+                position += piece.length;
+                amount -= piece.length;
+            }
+
+            return forEachPieceIn(node.right, position - left_total - node.piece.length, amount, func);
+        }
+    };
+} // namespace Helix
@@ -0,0 +1,165 @@
+#include "SaveJournal.hpp"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+
+#include "util.hpp"
+
+namespace Helix {
+	namespace {
+		constexpr std::array<char, 4> journal_magic = {'H', 'L', 'X', 'J'};
+		/// Written after the patches, xor'd with the amount of them. A journal without it wasn't finished.
+		constexpr uint64_t journal_commit = 0x48454C49584A4E4CULL;
+
+		template<typename T>
+		void writeValue (std::ostream& output, T value) {
+			output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		template<typename T>
+		bool readValue (std::istream& input, T& value) {
+			input.read(reinterpret_cast<char*>(&value), sizeof(T));
+			return static_cast<size_t>(input.gcount()) == sizeof(T);
+		}
+	}
+
+	// ==== SaveJournal ====
+	std::filesystem::path SaveJournal::getJournalPath (const std::filesystem::path& filename) {
+		std::filesystem::path result = filename;
+		result += ".helix-journal";
+		return result;
+	}
+
+	SaveJournal::WriteResult SaveJournal::write (const std::filesystem::path& filename, const std::vector<FilePatch>& patches, bool journaled) {
+		if (!journaled) {
+			return writePatches(filename, patches);
+		}
+
+		const std::filesystem::path journal_path = getJournalPath(filename);
+		{
+			std::ofstream journal(journal_path, std::ios::binary | std::ios::trunc);
+			if (!journal.is_open()) {
+				return WriteResult::Unchanged;
+			}
+
+			journal.write(journal_magic.data(), journal_magic.size());
+			writeValue<uint32_t>(journal, version);
+			writeValue<uint64_t>(journal, patches.size());
+			for (const FilePatch& patch : patches) {
+				writeValue<uint64_t>(journal, patch.position);
+				writeValue<uint64_t>(journal, patch.length);
+				journal.write(reinterpret_cast<const char*>(patch.data), static_cast<std::streamsize>(patch.length));
+			}
+			writeValue<uint64_t>(journal, journal_commit ^ patches.size());
+
+			// Closed here so that buffered writes that fail are noticed as well
+			journal.flush();
+			journal.close();
+			if (journal.fail()) {
+				std::filesystem::remove(journal_path);
+				return WriteResult::Unchanged;
+			}
+		}
+		// The journal has to be on the disk before the file is touched
+		if (!util::syncFile(journal_path)) {
+			std::filesystem::remove(journal_path);
+			return WriteResult::Unchanged;
+		}
+
+		const WriteResult result = writePatches(filename, patches);
+		if (result == WriteResult::Partial) {
+			// Leave the journal, so the next recover finishes the write
+			return result;
+		}
+
+		std::filesystem::remove(journal_path);
+		return result;
+	}
+
+	bool SaveJournal::recover (const std::filesystem::path& filename) {
+		const std::filesystem::path journal_path = getJournalPath(filename);
+		if (!std::filesystem::exists(journal_path)) {
+			return false;
+		}
+
+		std::vector<std::vector<std::byte>> datas;
+		std::vector<FilePatch> patches;
+		bool complete = false;
+		{
+			std::error_code error;
+			const uintmax_t journal_size = std::filesystem::file_size(journal_path, error);
+			std::ifstream journal(journal_path, std::ios::binary);
+			std::array<char, 4> magic;
+			uint32_t journal_version = 0;
+			uint64_t count = 0;
+			journal.read(magic.data(), magic.size());
+			if (
+				journal.gcount() == static_cast<std::streamsize>(magic.size()) && magic == journal_magic &&
+				readValue(journal, journal_version) && journal_version == version &&
+				readValue(journal, count)
+			) {
+				bool valid = true;
+				for (uint64_t index = 0; index < count && valid; index++) {
+					uint64_t position = 0;
+					uint64_t length = 0;
+					valid = readValue(journal, position) && readValue(journal, length);
+					// A corrupt length could otherwise ask for far more memory than there is
+					const std::streamoff offset = journal.tellg();
+					valid = valid && !error && offset >= 0 && length <= journal_size - static_cast<uintmax_t>(offset);
+					if (!valid) {
+						break;
+					}
+
+					std::vector<std::byte> data;
+					data.resize(static_cast<size_t>(length));
+					journal.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(length));
+					valid = static_cast<uint64_t>(journal.gcount()) == length;
+
+					patches.push_back(FilePatch{static_cast<AlphaFile::Absolute>(position), nullptr, static_cast<size_t>(length)});
+					datas.push_back(std::move(data));
+				}
+
+				uint64_t commit = 0;
+				complete = valid && readValue(journal, commit) && commit == (journal_commit ^ count);
+			}
+		}
+
+		if (!complete) {
+			// The write never got to the file itself
+			std::filesystem::remove(journal_path);
+			return false;
+		}
+
+		for (size_t index = 0; index < patches.size(); index++) {
+			patches[index].data = datas[index].data();
+		}
+		if (writePatches(filename, patches) != WriteResult::Written) {
+			return false;
+		}
+		std::filesystem::remove(journal_path);
+		return true;
+	}
+
+	SaveJournal::WriteResult SaveJournal::writePatches (const std::filesystem::path& filename, const std::vector<FilePatch>& patches) {
+		{
+			// in|out so that the file isn't truncated
+			std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+			if (!file.is_open()) {
+				return WriteResult::Unchanged;
+			}
+
+			for (const FilePatch& patch : patches) {
+				file.seekp(static_cast<std::streamoff>(patch.position));
+				file.write(reinterpret_cast<const char*>(patch.data), static_cast<std::streamsize>(patch.length));
+			}
+
+			file.flush();
+			file.close();
+			if (file.fail()) {
+				return WriteResult::Partial;
+			}
+		}
+		return util::syncFile(filename) ? WriteResult::Written : WriteResult::Partial;
+	}
+} // namespace Helix
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <filesystem>
+
+#include <AlphaFile.hpp>
+
+namespace Helix {
+    /// Bytes to write over part of a file, without changing its size
+    struct FilePatch {
+        AlphaFile::Absolute position;
+        const std::byte* data;
+        size_t length;
+    };
+
+    /// Writes patches straight into a file, optionally through a write-ahead journal.
+    /// With the journal the patches are first written (and synced) to a file next to it, and only then into the file.
+    /// If that is interrupted, recover finishes writing them from the journal, so the file ends up either entirely
+    /// unchanged or entirely patched.
+    class SaveJournal {
+        public:
+        /// Journal format version, written after the magic
+        static constexpr uint32_t version = 1;
+
+        /// Where the journal of a file is kept: [filename].helix-journal
+        static std::filesystem::path getJournalPath (const std::filesystem::path& filename);
+
+        enum class WriteResult {
+            Written = 0,
+            /// Nothing was written into the file
+            Unchanged,
+            /// Writing into the file failed after it was started, so it may be partly patched. If `journaled` was set
+            /// the journal is left in place, and recover finishes the write.
+            Partial,
+        };
+
+        static WriteResult write (const std::filesystem::path& filename, const std::vector<FilePatch>& patches, bool journaled);
+
+        /// Finishes an interrupted journaled write. A journal that wasn't completely written is thrown away, as
+        /// nothing was written into the file yet.
+        /// Returns true if there was a journal that was applied.
+        static bool recover (const std::filesystem::path& filename);
+
+        protected:
+        static WriteResult writePatches (const std::filesystem::path& filename, const std::vector<FilePatch>& patches);
+    };
+} // namespace Helix
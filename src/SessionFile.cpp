@@ -0,0 +1,311 @@
+#include "SessionFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+
+namespace Helix {
+	namespace {
+		constexpr std::array<char, 4> session_magic = {'H', 'L', 'X', 'S'};
+		constexpr size_t header_size = session_magic.size() + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(int64_t);
+
+		uint64_t zigzagEncode (int64_t value) {
+			return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+		}
+
+		int64_t zigzagDecode (uint64_t value) {
+			return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+		}
+
+		/// Each record starts with a tag byte: the record's kind, then its PayloadKind (for edits), then whether it
+		/// is the last record of its action
+		constexpr uint8_t tag_kind_mask = 0x03;
+		constexpr unsigned int tag_payload_shift = 2;
+		constexpr uint8_t tag_payload_mask = 0x03;
+		constexpr uint8_t tag_last_record = 0x10;
+
+		std::string_view asKey (const std::byte* data, size_t amount) {
+			return std::string_view(reinterpret_cast<const char*>(data), amount);
+		}
+	}
+
+	// ==== SessionFile ====
+	SessionFile::Base SessionFile::getBase (Storage& storage) {
+		Base base;
+		base.size = storage.getSize();
+		const std::filesystem::path filename = storage.getFilename();
+		if (!filename.empty()) {
+			std::error_code error;
+			const std::filesystem::file_time_type modified = std::filesystem::last_write_time(filename, error);
+			if (!error) {
+				base.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+			}
+		}
+		return base;
+	}
+
+	std::optional<std::vector<std::byte>> SessionFile::encode (ActionListLink& actions, const Base& base) {
+		std::vector<std::byte> output(header_size);
+		const uint32_t session_version = version;
+		std::memcpy(output.data(), session_magic.data(), session_magic.size());
+		std::memcpy(output.data() + session_magic.size(), &session_version, sizeof(session_version));
+		std::memcpy(output.data() + session_magic.size() + sizeof(session_version), &base.size, sizeof(base.size));
+		std::memcpy(output.data() + session_magic.size() + sizeof(session_version) + sizeof(base.size), &base.modified, sizeof(base.modified));
+
+		const size_t count = actions.getActionCount();
+		util::writeVarint(output, count);
+
+		// Index of each payload that can be referenced, keyed by its bytes. The keys point into the actions.
+		std::unordered_map<std::string_view, uint64_t> payloads;
+		AlphaFile::Natural previous_position = 0;
+		for (size_t index = 0; index < count; index++) {
+			const auto [begin, end] = actions.getActionRecords(index);
+			if (begin == end) {
+				return std::nullopt;
+			}
+
+			for (const ActionRecord* record = begin; record != end; record++) {
+				if (record->kind == ActionRecord::Kind::Opaque) {
+					return std::nullopt;
+				}
+
+				PayloadKind payload_kind = PayloadKind::Literal;
+				std::optional<uint64_t> reference;
+				std::optional<size_t> period;
+				if (record->kind == ActionRecord::Kind::Edit) {
+					if (record->amount >= min_reference_size) {
+						const auto [existing, inserted] = payloads.try_emplace(asKey(record->data, record->amount), payloads.size());
+						if (!inserted) {
+							reference = existing->second;
+						}
+					}
+
+					if (reference.has_value()) {
+						payload_kind = PayloadKind::Reference;
+					} else if ((period = findRepeatPeriod(record->data, record->amount))) {
+						payload_kind = PayloadKind::Repeat;
+					}
+				}
+
+				uint8_t tag = static_cast<uint8_t>(record->kind) | static_cast<uint8_t>(static_cast<uint8_t>(payload_kind) << tag_payload_shift);
+				if (record + 1 == end) {
+					tag |= tag_last_record;
+				}
+				output.push_back(std::byte(tag));
+				util::writeVarint(output, zigzagEncode(static_cast<int64_t>(record->position - previous_position)));
+				util::writeVarint(output, record->amount);
+				previous_position = record->position;
+
+				if (record->kind != ActionRecord::Kind::Edit) {
+					continue;
+				}
+
+				if (payload_kind == PayloadKind::Reference) {
+					util::writeVarint(output, reference.value());
+				} else if (payload_kind == PayloadKind::Repeat) {
+					util::writeVarint(output, period.value());
+					output.insert(output.end(), record->data, record->data + period.value());
+				} else {
+					output.insert(output.end(), record->data, record->data + record->amount);
+				}
+			}
+		}
+
+		const uint32_t session_checksum = util::checksum(output.data(), output.size());
+		const std::byte* checksum_bytes = reinterpret_cast<const std::byte*>(&session_checksum);
+		output.insert(output.end(), checksum_bytes, checksum_bytes + sizeof(session_checksum));
+		return output;
+	}
+
+	bool SessionFile::isValid (const std::byte* data, size_t length, const Base& base) {
+		if (length < header_size + sizeof(uint32_t) || std::memcmp(data, session_magic.data(), session_magic.size()) != 0) {
+			return false;
+		}
+
+		uint32_t stored_checksum = 0;
+		std::memcpy(&stored_checksum, data + length - sizeof(stored_checksum), sizeof(stored_checksum));
+		if (stored_checksum != util::checksum(data, length - sizeof(stored_checksum))) {
+			return false;
+		}
+
+		uint32_t session_version = 0;
+		Base session_base;
+		std::memcpy(&session_version, data + session_magic.size(), sizeof(session_version));
+		std::memcpy(&session_base.size, data + session_magic.size() + sizeof(session_version), sizeof(session_base.size));
+		std::memcpy(&session_base.modified, data + session_magic.size() + sizeof(session_version) + sizeof(session_base.size), sizeof(session_base.modified));
+		return session_version == version && session_base == base;
+	}
+
+	std::optional<std::vector<std::unique_ptr<BaseAction>>> SessionFile::decode (const std::byte* data, size_t length, const Base& base, std::pmr::memory_resource* resource) {
+		if (!isValid(data, length, base)) {
+			return std::nullopt;
+		}
+
+		const std::byte* position = data + header_size;
+		const std::byte* const end = data + length - sizeof(uint32_t);
+
+		const std::optional<uint64_t> count = util::readVarint(position, end);
+		if (!count.has_value()) {
+			return std::nullopt;
+		}
+
+		std::vector<std::unique_ptr<BaseAction>> result;
+		// Every action takes at least a byte, so this can't be made to allocate much by a bad count
+		result.reserve(static_cast<size_t>(std::min<uint64_t>(count.value(), static_cast<uint64_t>(end - position))));
+		// The payloads that can be referenced, in the order they were given their index
+		std::vector<const std::pmr::vector<std::byte>*> payloads;
+		AlphaFile::Natural previous_position = 0;
+		for (uint64_t index = 0; index < count.value(); index++) {
+			std::vector<std::unique_ptr<BaseAction>> parts;
+			bool last_record = false;
+			while (!last_record) {
+				if (position == end) {
+					return std::nullopt;
+				}
+				const uint8_t tag = static_cast<uint8_t>(*position);
+				position++;
+				const ActionRecord::Kind kind = static_cast<ActionRecord::Kind>(tag & tag_kind_mask);
+				const PayloadKind payload_kind = static_cast<PayloadKind>((tag >> tag_payload_shift) & tag_payload_mask);
+				last_record = (tag & tag_last_record) != 0;
+				const std::optional<uint64_t> delta = util::readVarint(position, end);
+				const std::optional<uint64_t> amount = util::readVarint(position, end);
+				if (!delta.has_value() || !amount.has_value()) {
+					return std::nullopt;
+				}
+				const AlphaFile::Natural record_position = previous_position + static_cast<AlphaFile::Natural>(zigzagDecode(delta.value()));
+				previous_position = record_position;
+
+				if (kind == ActionRecord::Kind::Insertion) {
+					parts.push_back(std::make_unique<InsertionAction>(record_position, static_cast<size_t>(amount.value())));
+					continue;
+				} else if (kind == ActionRecord::Kind::Deletion) {
+					parts.push_back(std::make_unique<DeletionAction>(record_position, static_cast<size_t>(amount.value())));
+					continue;
+				} else if (kind != ActionRecord::Kind::Edit) {
+					return std::nullopt;
+				}
+
+				std::vector<std::byte> bytes;
+				if (payload_kind == PayloadKind::Literal) {
+					if (static_cast<uint64_t>(end - position) < amount.value()) {
+						return std::nullopt;
+					}
+					bytes.assign(position, position + amount.value());
+					position += amount.value();
+				} else if (payload_kind == PayloadKind::Repeat) {
+					const std::optional<uint64_t> period = util::readVarint(position, end);
+					if (
+						!period.has_value() ||
+						period.value() == 0 ||
+						period.value() > amount.value() ||
+						static_cast<uint64_t>(end - position) < period.value()
+					) {
+						return std::nullopt;
+					}
+					bytes.resize(static_cast<size_t>(amount.value()));
+					for (size_t offset = 0; offset < bytes.size(); offset += period.value()) {
+						const size_t chunk = std::min<size_t>(period.value(), bytes.size() - offset);
+						std::copy(position, position + chunk, bytes.begin() + offset);
+					}
+					position += period.value();
+				} else if (payload_kind == PayloadKind::Reference) {
+					const std::optional<uint64_t> payload_index = util::readVarint(position, end);
+					if (
+						!payload_index.has_value() ||
+						payload_index.value() >= payloads.size() ||
+						payloads[payload_index.value()]->size() != amount.value()
+					) {
+						return std::nullopt;
+					}
+					const std::pmr::vector<std::byte>& referenced = *payloads[payload_index.value()];
+					bytes.assign(referenced.begin(), referenced.end());
+				} else {
+					return std::nullopt;
+				}
+
+				auto action = std::make_unique<EditAction>(record_position, std::move(bytes), resource);
+				if (payload_kind != PayloadKind::Reference && action->data.size() >= min_reference_size) {
+					payloads.push_back(&action->data);
+				}
+				parts.push_back(std::move(action));
+			}
+
+			if (parts.size() == 1) {
+				result.push_back(std::move(parts.front()));
+			} else {
+				result.push_back(std::make_unique<BundledAction>(std::move(parts)));
+			}
+		}
+
+		if (position != end) {
+			return std::nullopt;
+		}
+		return result;
+	}
+
+	bool SessionFile::write (const std::filesystem::path& path, ActionListLink& actions, const Base& base) {
+		const std::optional<std::vector<std::byte>> encoded = encode(actions, base);
+		if (!encoded.has_value()) {
+			return false;
+		}
+
+		// Written next to it and then moved over it, so a failed write leaves the previous session as it was
+		std::filesystem::path temp_path = path;
+		temp_path += ".tmp";
+		std::error_code error;
+		{
+			std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				return false;
+			}
+			file.write(reinterpret_cast<const char*>(encoded.value().data()), static_cast<std::streamsize>(encoded.value().size()));
+			file.close();
+			if (file.fail()) {
+				std::filesystem::remove(temp_path, error);
+				return false;
+			}
+		}
+		if (!util::syncFile(temp_path)) {
+			std::filesystem::remove(temp_path, error);
+			return false;
+		}
+
+		std::filesystem::rename(temp_path, path, error);
+		if (error) {
+			std::filesystem::remove(temp_path, error);
+			return false;
+		}
+		return true;
+	}
+
+	std::optional<std::vector<std::byte>> SessionFile::read (const std::filesystem::path& path) {
+		std::ifstream input(path, std::ios::binary | std::ios::ate);
+		if (!input.is_open()) {
+			return std::nullopt;
+		}
+		std::vector<std::byte> contents(static_cast<size_t>(input.tellg()));
+		input.seekg(0);
+		input.read(reinterpret_cast<char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+		if (!input.good()) {
+			return std::nullopt;
+		}
+		return contents;
+	}
+
+	std::optional<size_t> SessionFile::findRepeatPeriod (const std::byte* data, size_t amount) {
+		const size_t longest = std::min(max_repeat_period, amount / 2);
+		for (size_t period = 1; period <= longest; period++) {
+			// Worth it only if the pattern (and its length) is smaller than the bytes
+			if (period + 2 >= amount) {
+				break;
+			}
+			if (std::equal(data + period, data + amount, data)) {
+				return period;
+			}
+		}
+		return std::nullopt;
+	}
+} // namespace Helix
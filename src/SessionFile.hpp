@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <filesystem>
+
+#include "Helix.hpp"
+
+namespace Helix {
+    /// Stores the actions of a session in a file of their own, so that they can be loaded again later on top of the
+    /// same (unsaved) file rather than being redone.
+    ///
+    /// The format is meant to be small and quick to read:
+    /// - positions are varints of the difference from the previous record's position, as edits tend to be close
+    ///   together
+    /// - edited bytes that repeat a short pattern (such as an insertion filled with a pattern) are stored as the
+    ///   pattern once
+    /// - edited bytes that are the same as an earlier action's are stored as a reference to it
+    ///
+    /// Like ActionJournal, actions are stored by their ActionRecords, so sessions with user-defined (Opaque) actions
+    /// can't be stored.
+    class SessionFile {
+        public:
+        static constexpr uint32_t version = 2;
+
+        /// The unmodified file that a session was made on top of, which it can only be loaded on top of
+        struct Base {
+            uint64_t size = 0;
+            /// When the file was last written to, in ticks of the filesystem's clock. 0 if it isn't backed by a file.
+            int64_t modified = 0;
+
+            bool operator== (const Base& other) const {
+                return size == other.size && modified == other.modified;
+            }
+        };
+
+        /// The base that the unmodified file read through `storage` makes
+        static Base getBase (Storage& storage);
+
+        /// Encodes the actions. Returns nullopt if any of them can't be stored.
+        static std::optional<std::vector<std::byte>> encode (ActionListLink& actions, const Base& base);
+        /// Whether the data is an uncorrupted session of this version, made on top of `base`
+        static bool isValid (const std::byte* data, size_t length, const Base& base);
+        /// Decodes the actions from `encode`. Returns nullopt if the data isn't valid (see isValid) or can't be decoded.
+        static std::optional<std::vector<std::unique_ptr<BaseAction>>> decode (const std::byte* data, size_t length, const Base& base, std::pmr::memory_resource* resource);
+
+        /// Encodes the actions into the file at `path`, replacing it. Returns whether it was written, if not then any
+        /// session that was already at `path` is left as it was.
+        static bool write (const std::filesystem::path& path, ActionListLink& actions, const Base& base);
+        /// The contents of the file at `path`, for decode. Returns nullopt if it can't be opened.
+        static std::optional<std::vector<std::byte>> read (const std::filesystem::path& path);
+
+        protected:
+        /// How an edit's bytes are stored
+        enum class PayloadKind : uint8_t {
+            /// The bytes themselves
+            Literal = 0,
+            /// A pattern, repeated until the amount of the edit
+            Repeat,
+            /// The index of an earlier payload with the same bytes
+            Reference,
+        };
+
+        /// Payloads smaller than this aren't deduplicated (and so aren't given an index), as the reference would be
+        /// about as large as the bytes
+        static constexpr size_t min_reference_size = 8;
+        /// Longest pattern that is looked for in edited bytes
+        static constexpr size_t max_repeat_period = 16;
+
+        /// The length of the shortest pattern that `data` repeats (at least twice), if there is one
+        static std::optional<size_t> findRepeatPeriod (const std::byte* data, size_t amount);
+    };
+} // namespace Helix
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+namespace Helix {
+    /// A counter that is bumped by one thread at a time (such as the worker thread of a background save), and can be
+    /// read from any thread.
+    /// Adding is a relaxed load and store rather than an atomic add, as it's done for every byte read and there's never
+    /// a second thread adding at the same time to lose updates to. The counters are only read to be reported, never to
+    /// order anything else.
+    /// Without HELIX_USE_STATS the counter holds nothing and adding to it does nothing, so it compiles out entirely.
+    class StatCounter {
+        public:
+        void add (uint64_t amount=1) {
+#ifdef HELIX_USE_STATS
+            value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+#endif
+        }
+
+        uint64_t get () const {
+#ifdef HELIX_USE_STATS
+            return value.load(std::memory_order_relaxed);
+#else
+            return 0;
+#endif
+        }
+
+        void reset () {
+#ifdef HELIX_USE_STATS
+            value.store(0, std::memory_order_relaxed);
+#endif
+        }
+
+#ifdef HELIX_USE_STATS
+        protected:
+        std::atomic<uint64_t> value = 0;
+#endif
+    };
+} // namespace Helix
@@ -0,0 +1,291 @@
+#include "Storage.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Helix {
+	// ==== FileStorage ====
+	FileStorage::FileStorage (const std::filesystem::path& filename, AlphaFile::OpenFlags flags, size_t block_size, size_t max_block_count, std::optional<AlphaFile::Absolute> start, std::optional<AlphaFile::Absolute> end) :
+		filename(filename), flags(flags), block_size(block_size), max_block_count(max_block_count), start(start), end(end) {
+		open();
+	}
+
+	void FileStorage::open () {
+		file = std::make_unique<AlphaFile::BlockCachedFile<AlphaFile::ConstrainedFile>>(block_size, max_block_count);
+		file->getUnderlyingFile().setStart(start);
+		file->getUnderlyingFile().setEnd(end);
+		file->open(flags, filename);
+	}
+
+	std::optional<std::byte> FileStorage::read (AlphaFile::Natural position) {
+		return file->read(position);
+	}
+	size_t FileStorage::read (AlphaFile::Natural position, std::byte* output, size_t amount) {
+		if (amount <= small_read_length) {
+			for (size_t i = 0; i < amount; i++) {
+				std::optional<std::byte> byte_opt = file->read(position + i);
+				if (!byte_opt.has_value()) {
+					return i;
+				}
+				output[i] = byte_opt.value();
+			}
+			return amount;
+		}
+
+		std::vector<std::byte> bytes = file->read(position, amount);
+		std::memcpy(output, bytes.data(), bytes.size());
+		return bytes.size();
+	}
+
+	size_t FileStorage::getSize () {
+		return file->getSize();
+	}
+	size_t FileStorage::getEditableSize () {
+		return file->getUnderlyingFile().getEditableSize();
+	}
+
+	bool FileStorage::isWritable () const {
+		return file->isWritable();
+	}
+
+	std::filesystem::path FileStorage::getFilename () {
+		return file->getFilename();
+	}
+
+	AlphaFile::BasicFile* FileStorage::getBasicFile () {
+		return &file->getUnderlyingFile().getBasicFile();
+	}
+
+	void FileStorage::invalidate () {
+		open();
+	}
+
+	AlphaFile::BlockCachedFile<AlphaFile::ConstrainedFile>& FileStorage::getFile () {
+		return *file;
+	}
+
+	// ==== MappedStorage ====
+	MappedStorage::MappedStorage (const std::filesystem::path& filename, AlphaFile::OpenFlags flags, size_t block_size, size_t max_block_count, std::optional<AlphaFile::Absolute> start, std::optional<AlphaFile::Absolute> end) :
+		FileStorage(filename, flags, block_size, max_block_count, start, end) {
+		map();
+	}
+
+	void MappedStorage::map () {
+		mapped_file.reset();
+		auto mapping = std::make_unique<MappedFile>(filename, start, end);
+		// If the file can't be mapped we just keep reading through the block cache
+		if (mapping->isMapped()) {
+			mapped_file = std::move(mapping);
+			mapped_file->advise(access_pattern);
+		}
+		last_read_end = 0;
+		prefetched_end = 0;
+	}
+
+	std::optional<std::byte> MappedStorage::read (AlphaFile::Natural position) {
+		if (mapped_file) {
+			noteRead(position, 1);
+			return mapped_file->read(position);
+		}
+		return FileStorage::read(position);
+	}
+	size_t MappedStorage::read (AlphaFile::Natural position, std::byte* output, size_t amount) {
+		if (mapped_file) {
+			noteRead(position, amount);
+			return mapped_file->read(position, output, amount);
+		}
+		return FileStorage::read(position, output, amount);
+	}
+
+	void MappedStorage::setAccessPattern (AccessPattern pattern) {
+		access_pattern = pattern;
+		if (mapped_file) {
+			mapped_file->advise(pattern);
+		}
+	}
+
+	void MappedStorage::setReadAhead (size_t amount) {
+		read_ahead = amount;
+		prefetched_end = 0;
+	}
+
+	void MappedStorage::noteRead (AlphaFile::Natural position, size_t amount) {
+		const bool sequential = position == last_read_end;
+		last_read_end = position + amount;
+		if (read_ahead == 0 || !sequential) {
+			return;
+		}
+
+		// Asking again on every read would cost a syscall each, so only top it up once half of it was read
+		if (last_read_end + (read_ahead / 2) >= prefetched_end) {
+			const AlphaFile::Natural start = std::max(prefetched_end, last_read_end);
+			prefetched_end = last_read_end + read_ahead;
+			mapped_file->prefetch(start, static_cast<size_t>(prefetched_end - start));
+		}
+	}
+
+	bool MappedStorage::isMapped () const {
+		return mapped_file != nullptr;
+	}
+
+	void MappedStorage::invalidate () {
+		FileStorage::invalidate();
+		map();
+	}
+
+	// ==== MemoryStorage ====
+	MemoryStorage::MemoryStorage (std::vector<std::byte>&& t_data) : data(std::move(t_data)) {}
+
+	std::optional<std::byte> MemoryStorage::read (AlphaFile::Natural position) {
+		if (position >= data.size()) {
+			return std::nullopt;
+		}
+		return data[position];
+	}
+	size_t MemoryStorage::read (AlphaFile::Natural position, std::byte* output, size_t amount) {
+		if (position >= data.size()) {
+			return 0;
+		}
+		amount = std::min(amount, static_cast<size_t>(data.size() - position));
+		std::memcpy(output, data.data() + position, amount);
+		return amount;
+	}
+
+	size_t MemoryStorage::getSize () {
+		return data.size();
+	}
+
+	bool MemoryStorage::isWritable () const {
+		return false;
+	}
+
+	// ==== CachedStorage ====
+	CachedStorage::CachedStorage (std::unique_ptr<Storage>&& t_storage, CachePolicy policy, size_t block_size, size_t capacity_bytes) :
+		storage(std::move(t_storage)), cache(policy, block_size, capacity_bytes) {}
+
+	std::optional<std::byte> CachedStorage::read (AlphaFile::Natural position) {
+		const size_t block_size = cache.getBlockSize();
+		const std::vector<std::byte>& block = getBlock(position / block_size);
+		const size_t offset = static_cast<size_t>(position % block_size);
+		if (offset >= block.size()) {
+			return std::nullopt;
+		}
+		return block[offset];
+	}
+	size_t CachedStorage::read (AlphaFile::Natural position, std::byte* output, size_t amount) {
+		const size_t block_size = cache.getBlockSize();
+		size_t written = 0;
+		while (written < amount) {
+			const AlphaFile::Natural current = position + written;
+			const std::vector<std::byte>& block = getBlock(current / block_size);
+			const size_t offset = static_cast<size_t>(current % block_size);
+			if (offset >= block.size()) {
+				break;
+			}
+
+			const size_t length = std::min(amount - written, block.size() - offset);
+			std::memcpy(output + written, block.data() + offset, length);
+			written += length;
+
+			// A short block is the end of the file
+			if (block.size() < block_size) {
+				break;
+			}
+		}
+		return written;
+	}
+
+	size_t CachedStorage::getSize () {
+		return storage->getSize();
+	}
+	size_t CachedStorage::getEditableSize () {
+		return storage->getEditableSize();
+	}
+
+	bool CachedStorage::isWritable () const {
+		return storage->isWritable();
+	}
+
+	std::filesystem::path CachedStorage::getFilename () {
+		return storage->getFilename();
+	}
+
+	AlphaFile::BasicFile* CachedStorage::getBasicFile () {
+		return storage->getBasicFile();
+	}
+
+	void CachedStorage::setAccessPattern (AccessPattern pattern) {
+		storage->setAccessPattern(pattern);
+	}
+
+	void CachedStorage::setReadAhead (size_t amount) {
+		const size_t block_size = cache.getBlockSize();
+		// Read ahead blocks go through the cache, so they're kept to a small part of it to not push everything else out
+		read_ahead_blocks = std::min((amount + block_size - 1) / block_size, cache.getCapacity() / 4);
+	}
+
+	bool CachedStorage::isMapped () const {
+		return storage->isMapped();
+	}
+
+	std::optional<CacheStats> CachedStorage::getCacheStats () const {
+		return cache.getStats();
+	}
+
+	void CachedStorage::resetCacheStats () {
+		cache.resetStats();
+	}
+
+	void CachedStorage::invalidate () {
+		cache.clear();
+		storage->invalidate();
+	}
+
+	BlockCache& CachedStorage::getCache () {
+		return cache;
+	}
+
+	const std::vector<std::byte>& CachedStorage::getBlock (uint64_t index) {
+		if (index == last_block + 1) {
+			sequential_run++;
+		} else if (index != last_block) {
+			sequential_run = 0;
+		}
+		last_block = index;
+
+		if (const std::vector<std::byte>* block = cache.find(index)) {
+			return *block;
+		}
+
+		size_t count = 1;
+		if (read_ahead_blocks != 0 && sequential_run >= sequential_threshold) {
+			count += read_ahead_blocks;
+		}
+		return fetchBlocks(index, count);
+	}
+
+	const std::vector<std::byte>& CachedStorage::fetchBlocks (uint64_t index, size_t count) {
+		const size_t block_size = cache.getBlockSize();
+		std::vector<std::byte> data;
+		data.resize(block_size * count);
+		data.resize(storage->read(static_cast<AlphaFile::Natural>(index * block_size), data.data(), data.size()));
+
+		// Cached from the furthest block back, so the block that was asked for is the most recent one
+		for (size_t i = count - 1; i > 0; i--) {
+			const size_t offset = i * block_size;
+			if (offset >= data.size() || cache.contains(index + i)) {
+				continue;
+			}
+			const size_t length = std::min(block_size, data.size() - offset);
+			cache.insert(index + i, std::vector<std::byte>(data.begin() + static_cast<ptrdiff_t>(offset), data.begin() + static_cast<ptrdiff_t>(offset + length)), true);
+		}
+
+		if (data.empty()) {
+			// Past the end of the file. Not cached, as it would only take a slot to say there's nothing there.
+			static const std::vector<std::byte> empty_block;
+			return empty_block;
+		}
+		data.resize(std::min(block_size, data.size()));
+		return cache.insert(index, std::move(data));
+	}
+} // namespace Helix
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <optional>
+#include <memory>
+#include <filesystem>
+
+#include <AlphaFile.hpp>
+
+#include "MappedFile.hpp"
+#include "BlockCache.hpp"
+
+namespace Helix {
+    /// Where Helix reads the unmodified bytes of the file from, and what it saves over.
+    /// Positions are natural positions of the unmodified file (so, relative to the start in constrained modes).
+    struct Storage {
+        virtual ~Storage () {}
+
+        virtual std::optional<std::byte> read (AlphaFile::Natural position) = 0;
+        /// Copies up to `amount` bytes into output, returning how many there were
+        virtual size_t read (AlphaFile::Natural position, std::byte* output, size_t amount) = 0;
+
+        virtual size_t getSize () = 0;
+        virtual size_t getEditableSize () {
+            return getSize();
+        }
+
+        virtual bool isWritable () const = 0;
+
+        /// The file that saving writes over and that Replay saves copy from.
+        /// Empty if the storage isn't backed by a file, in which case it can only be saved elsewhere with saveAs.
+        virtual std::filesystem::path getFilename () {
+            return std::filesystem::path();
+        }
+
+        /// The file that in-place saves write into, or nullptr if that isn't possible.
+        virtual AlphaFile::BasicFile* getBasicFile () {
+            return nullptr;
+        }
+
+        /// Hint for how the storage will be read. Ignored by default.
+        virtual void setAccessPattern (AccessPattern pattern) {}
+
+        /// How many bytes to read ahead once reads are found to be sequential, 0 to not read ahead.
+        /// Ignored by default.
+        virtual void setReadAhead (size_t amount) {}
+
+        virtual bool isMapped () const {
+            return false;
+        }
+
+        /// Hit/miss counts of the storage's cache, if it has one that keeps them
+        virtual std::optional<CacheStats> getCacheStats () const {
+            return std::nullopt;
+        }
+        virtual void resetCacheStats () {}
+
+        /// Drops anything cached about the file, for after it was written to without going through the storage or was
+        /// replaced by a new file at the same path
+        virtual void invalidate () {}
+    };
+
+    /// A file read through AlphaFile's block cache
+    class FileStorage : public Storage {
+        protected:
+        /// Held by pointer so invalidate can replace it with a freshly opened one, as the block cache can't be
+        /// emptied otherwise
+        std::unique_ptr<AlphaFile::BlockCachedFile<AlphaFile::ConstrainedFile>> file;
+
+        std::filesystem::path filename;
+        AlphaFile::OpenFlags flags;
+        size_t block_size;
+        size_t max_block_count;
+        std::optional<AlphaFile::Absolute> start;
+        std::optional<AlphaFile::Absolute> end;
+
+        public:
+        /// Ranges at most this long are read byte by byte out of the block cache, rather than with a ranged read
+        /// that has to allocate. This keeps small (typed) reads allocation free.
+        static constexpr size_t small_read_length = 16;
+
+        explicit FileStorage (const std::filesystem::path& filename, AlphaFile::OpenFlags flags, size_t block_size, size_t max_block_count, std::optional<AlphaFile::Absolute> start=std::nullopt, std::optional<AlphaFile::Absolute> end=std::nullopt);
+
+        std::optional<std::byte> read (AlphaFile::Natural position) override;
+        size_t read (AlphaFile::Natural position, std::byte* output, size_t amount) override;
+
+        size_t getSize () override;
+        size_t getEditableSize () override;
+
+        bool isWritable () const override;
+
+        std::filesystem::path getFilename () override;
+
+        AlphaFile::BasicFile* getBasicFile () override;
+
+        /// Reopens the file, so the blocks cached from before it was written to are dropped, and reads go to the file
+        /// that is at the path now.
+        /// Anything previously returned by getBasicFile/getFile is no longer valid afterwards.
+        void invalidate () override;
+
+        AlphaFile::BlockCachedFile<AlphaFile::ConstrainedFile>& getFile ();
+
+        protected:
+        void open ();
+    };
+
+    /// A file whose reads are served from a memory mapping of it. Everything else (size, saving) goes through the
+    /// file as with FileStorage.
+    /// If the file can't be mapped then it reads through the block cache, see isMapped.
+    class MappedStorage : public FileStorage {
+        protected:
+        std::unique_ptr<MappedFile> mapped_file;
+        AccessPattern access_pattern = AccessPattern::Normal;
+
+        size_t read_ahead = 0;
+        /// Where the last read ended, a read starting there is sequential
+        AlphaFile::Natural last_read_end = 0;
+        /// How far the OS was already asked to read ahead
+        AlphaFile::Natural prefetched_end = 0;
+
+        public:
+        explicit MappedStorage (const std::filesystem::path& filename, AlphaFile::OpenFlags flags, size_t block_size, size_t max_block_count, std::optional<AlphaFile::Absolute> start=std::nullopt, std::optional<AlphaFile::Absolute> end=std::nullopt);
+
+        std::optional<std::byte> read (AlphaFile::Natural position) override;
+        size_t read (AlphaFile::Natural position, std::byte* output, size_t amount) override;
+
+        void setAccessPattern (AccessPattern pattern) override;
+
+        void setReadAhead (size_t amount) override;
+
+        bool isMapped () const override;
+
+        /// Maps the file at the path again, along with reopening it
+        void invalidate () override;
+
+        protected:
+        /// Maps the file, if it can be
+        void map ();
+
+        /// Asks for the next read_ahead bytes once reading goes past half of what was already asked for
+        void noteRead (AlphaFile::Natural position, size_t amount);
+    };
+
+    /// Bytes held in memory, not backed by any file.
+    /// Can't be saved over, only saved elsewhere (and only by streaming).
+    class MemoryStorage : public Storage {
+        protected:
+        std::vector<std::byte> data;
+
+        public:
+        explicit MemoryStorage (std::vector<std::byte>&& t_data);
+
+        std::optional<std::byte> read (AlphaFile::Natural position) override;
+        size_t read (AlphaFile::Natural position, std::byte* output, size_t amount) override;
+
+        size_t getSize () override;
+
+        bool isWritable () const override;
+    };
+
+    /// Another storage with reads served out of a BlockCache, whose eviction policy can be picked.
+    /// The wrapped storage is read a block at a time, so it shouldn't do much caching of its own.
+    class CachedStorage : public Storage {
+        protected:
+        std::unique_ptr<Storage> storage;
+        BlockCache cache;
+
+        /// Blocks read along with a missed block, when reads are sequential
+        size_t read_ahead_blocks = 0;
+        /// The last block that was read, and how many blocks in a row before it were read in order
+        uint64_t last_block = 0;
+        size_t sequential_run = 0;
+
+        public:
+        explicit CachedStorage (std::unique_ptr<Storage>&& t_storage, CachePolicy policy, size_t block_size, size_t capacity_bytes);
+
+        std::optional<std::byte> read (AlphaFile::Natural position) override;
+        size_t read (AlphaFile::Natural position, std::byte* output, size_t amount) override;
+
+        size_t getSize () override;
+        size_t getEditableSize () override;
+
+        bool isWritable () const override;
+
+        std::filesystem::path getFilename () override;
+
+        AlphaFile::BasicFile* getBasicFile () override;
+
+        void setAccessPattern (AccessPattern pattern) override;
+
+        void setReadAhead (size_t amount) override;
+
+        bool isMapped () const override;
+
+        std::optional<CacheStats> getCacheStats () const override;
+        void resetCacheStats () override;
+
+        void invalidate () override;
+
+        BlockCache& getCache ();
+
+        /// Amount of blocks read in order before reading ahead starts
+        static constexpr size_t sequential_threshold = 2;
+
+        protected:
+        /// The block from the cache, read from the wrapped storage if it isn't in it.
+        /// Only the last block of the file is shorter than the block size.
+        const std::vector<std::byte>& getBlock (uint64_t index);
+
+        /// Reads `count` blocks starting at `index` with a single read and caches those that aren't already.
+        /// Returns the block at `index`, which must not be cached yet. Blocks past the end of the file are empty, and
+        /// aren't cached.
+        const std::vector<std::byte>& fetchBlocks (uint64_t index, size_t count);
+    };
+} // namespace Helix
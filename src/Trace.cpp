@@ -0,0 +1,143 @@
+#include "Trace.hpp"
+
+#include <fstream>
+
+namespace Helix {
+	namespace {
+		std::string escapeJson (std::string_view text) {
+			std::string result;
+			result.reserve(text.size() + 2);
+			result.push_back('"');
+			for (const char value : text) {
+				switch (value) {
+					case '"':
+						result += "\\\"";
+						break;
+					case '\\':
+						result += "\\\\";
+						break;
+					case '\n':
+						result += "\\n";
+						break;
+					case '\t':
+						result += "\\t";
+						break;
+					default:
+						if (static_cast<unsigned char>(value) < 0x20) {
+							static constexpr char hex[] = "0123456789abcdef";
+							result += "\\u00";
+							result.push_back(hex[(value >> 4) & 0x0F]);
+							result.push_back(hex[value & 0x0F]);
+						} else {
+							result.push_back(value);
+						}
+						break;
+				}
+			}
+			result.push_back('"');
+			return result;
+		}
+	}
+
+	// ==== Tracer:Constructors ====
+	Tracer::Tracer () : origin(std::chrono::steady_clock::now()) {}
+
+	// ==== Tracer ====
+	int64_t Tracer::now () const {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+	}
+
+	uint32_t Tracer::getThreadId () {
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto [iterator, inserted] = thread_ids.try_emplace(std::this_thread::get_id(), static_cast<uint32_t>(thread_ids.size() + 1));
+		return iterator->second;
+	}
+
+	void Tracer::record (Event&& event) {
+		std::lock_guard<std::mutex> lock(mutex);
+		events.push_back(std::move(event));
+	}
+
+	size_t Tracer::getEventCount () const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return events.size();
+	}
+
+	void Tracer::clear () {
+		std::lock_guard<std::mutex> lock(mutex);
+		events.clear();
+	}
+
+	void Tracer::write (std::ostream& output) const {
+		std::lock_guard<std::mutex> lock(mutex);
+		output << "{\"traceEvents\":[";
+		for (size_t index = 0; index < events.size(); index++) {
+			const Event& event = events[index];
+			if (index != 0) {
+				output << ",";
+			}
+			// Complete events, which carry their own duration
+			output << "\n{\"name\":" << escapeJson(event.name)
+				<< ",\"cat\":" << escapeJson(event.category)
+				<< ",\"ph\":\"X\",\"ts\":" << event.start
+				<< ",\"dur\":" << event.duration
+				<< ",\"pid\":1,\"tid\":" << event.thread;
+			if (!event.args.empty()) {
+				output << ",\"args\":{";
+				for (size_t arg = 0; arg < event.args.size(); arg++) {
+					if (arg != 0) {
+						output << ",";
+					}
+					output << escapeJson(event.args[arg].first) << ":" << event.args[arg].second;
+				}
+				output << "}";
+			}
+			output << "}";
+		}
+		output << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	}
+
+	bool Tracer::write (const std::filesystem::path& path) const {
+		std::ofstream output(path, std::ios::trunc);
+		if (!output.is_open()) {
+			return false;
+		}
+		write(output);
+		return output.good();
+	}
+
+	// ==== TraceSpan:Constructors ====
+	TraceSpan::TraceSpan (Tracer* t_tracer, std::string_view name, const char* category) : tracer(t_tracer) {
+		if (tracer) {
+			event.name = name;
+			event.category = category;
+			event.thread = tracer->getThreadId();
+			event.start = tracer->now();
+		}
+	}
+
+	TraceSpan::~TraceSpan () {
+		end();
+	}
+
+	// ==== TraceSpan ====
+	void TraceSpan::addArg (std::string_view name, uint64_t value) {
+		if (tracer) {
+			event.args.emplace_back(std::string(name), std::to_string(value));
+		}
+	}
+
+	void TraceSpan::addArg (std::string_view name, std::string_view value) {
+		if (tracer) {
+			event.args.emplace_back(std::string(name), escapeJson(value));
+		}
+	}
+
+	void TraceSpan::end () {
+		if (tracer) {
+			event.duration = tracer->now() - event.start;
+			tracer->record(std::move(event));
+			tracer = nullptr;
+		}
+	}
+} // namespace Helix
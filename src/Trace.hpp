@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Helix {
+    /// Collects timed spans, such as the phases of a save, and writes them out in the Chrome trace event format,
+    /// which chrome://tracing and Perfetto can open.
+    /// Spans can be recorded from any thread.
+    class Tracer {
+        public:
+        struct Event {
+            std::string name;
+            const char* category = "";
+            /// Microseconds since the tracer was created
+            int64_t start = 0;
+            int64_t duration = 0;
+            uint32_t thread = 0;
+            /// Names and already JSON-encoded values
+            std::vector<std::pair<std::string, std::string>> args;
+        };
+
+        explicit Tracer ();
+
+        Tracer (const Tracer&) = delete;
+        Tracer& operator= (const Tracer&) = delete;
+
+        /// Microseconds since the tracer was created
+        int64_t now () const;
+        /// Small id for the calling thread, as trace viewers show a row per id
+        uint32_t getThreadId ();
+
+        void record (Event&& event);
+
+        size_t getEventCount () const;
+        /// Forgets the recorded spans
+        void clear ();
+
+        /// Writes the recorded spans as a JSON trace
+        void write (std::ostream& output) const;
+        /// Writes the recorded spans to a file, returning whether it could be written
+        bool write (const std::filesystem::path& path) const;
+
+        protected:
+        std::chrono::steady_clock::time_point origin;
+
+        mutable std::mutex mutex;
+        std::vector<Event> events;
+        std::map<std::thread::id, uint32_t> thread_ids;
+    };
+
+    /// Records the time from its construction until it is destroyed (or ended) as a span of the tracer.
+    /// Does nothing if the tracer is null, so it can be left in hot paths.
+    class TraceSpan {
+        public:
+        explicit TraceSpan (Tracer* t_tracer, std::string_view name, const char* category);
+        ~TraceSpan ();
+
+        TraceSpan (const TraceSpan&) = delete;
+        TraceSpan& operator= (const TraceSpan&) = delete;
+
+        void addArg (std::string_view name, uint64_t value);
+        void addArg (std::string_view name, std::string_view value);
+
+        /// Records the span now, rather than when it is destroyed
+        void end ();
+
+        protected:
+        Tracer* tracer;
+        Tracer::Event event;
+    };
+} // namespace Helix
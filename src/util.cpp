@@ -1,5 +1,11 @@
 #include "util.hpp"
 
+#if defined(__unix__) || defined(__APPLE__)
+#define HELIX_HAS_FSYNC
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
 namespace Helix::util {
 	char nibbleToChar (std::byte value) {
         if (value <= std::byte(9)) {
@@ -18,4 +24,62 @@ namespace Helix::util {
     std::pair<char, char> byteToString (std::byte value) {
         return byteToString(value, false);
     }
-}
\ No newline at end of file
+
+    std::optional<size_t> getAvailableMemory () {
+#if defined(_SC_AVPHYS_PAGES) && defined(_SC_PAGESIZE)
+        const long pages = sysconf(_SC_AVPHYS_PAGES);
+        const long page_size = sysconf(_SC_PAGESIZE);
+        if (pages > 0 && page_size > 0) {
+            return static_cast<size_t>(pages) * static_cast<size_t>(page_size);
+        }
+#endif
+        return std::nullopt;
+    }
+
+    bool syncFile (const std::filesystem::path& filename) {
+#ifdef HELIX_HAS_FSYNC
+        const int descriptor = ::open(filename.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            return false;
+        }
+        const bool synced = fsync(descriptor) == 0;
+        return ::close(descriptor) == 0 && synced;
+#else
+        return true;
+#endif
+    }
+
+    void writeVarint (std::vector<std::byte>& output, uint64_t value) {
+        while (value >= 0x80) {
+            output.push_back(std::byte(static_cast<uint8_t>(value) | 0x80));
+            value >>= 7;
+        }
+        output.push_back(std::byte(static_cast<uint8_t>(value)));
+    }
+
+    std::optional<uint64_t> readVarint (const std::byte*& position, const std::byte* end) {
+        uint64_t value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7) {
+            if (position == end) {
+                return std::nullopt;
+            }
+            const uint8_t byte = static_cast<uint8_t>(*position);
+            position++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        return std::nullopt;
+    }
+
+    uint32_t checksum (const std::byte* data, size_t length) {
+        // FNV-1a
+        uint32_t hash = 2166136261u;
+        for (size_t index = 0; index < length; index++) {
+            hash ^= static_cast<uint32_t>(data[index]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+}
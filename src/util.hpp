@@ -5,7 +5,10 @@
 #include <optional>
 #include <functional>
 #include <map>
+#include <vector>
 #include <cstddef>
+#include <cstdint>
+#include <filesystem>
 
 namespace Helix::util {
     namespace optional {
@@ -97,6 +100,21 @@ namespace Helix::util {
     std::pair<char, char> byteToString (std::byte value, bool padded);
     std::pair<char, char> byteToString (std::byte value);
 
+    /// Amount of physical memory that is currently free, if the platform lets us find out
+    std::optional<size_t> getAvailableMemory ();
+
+    /// Makes sure what was written to the file is on the disk, where the platform lets us.
+    /// Returns false if it couldn't be, in which case the writes may not have made it to the disk.
+    bool syncFile (const std::filesystem::path& filename);
+
+    /// Appends `value` as a LEB128 varint: 7 bits per byte, low bits first, high bit set on every byte but the last
+    void writeVarint (std::vector<std::byte>& output, uint64_t value);
+    /// Reads a varint from [position, end), moving position past it. Returns nullopt if it is cut off or too long.
+    std::optional<uint64_t> readVarint (const std::byte*& position, const std::byte* end);
+
+    /// Cheap checksum of the bytes, only meant for noticing torn or corrupted writes
+    uint32_t checksum (const std::byte* data, size_t length);
+
     template<typename K, typename V>
     V* mapFindEntry (std::map<K, V>& map, K key) {
         auto iterator = map.find(key);